@@ -0,0 +1,85 @@
+// Measures the lookup throughput of threads reading one shared document at once.
+//
+// Usage: concurrentreads [lookups per thread]
+//
+// Every thread looks up the same paths through the const accessors, with no locking.
+// Since readers share nothing they write to, the throughput should grow linearly with the
+// number of threads, up to the number of cores.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../cppjson/cppjson.hpp"
+
+static std::string makeInput()
+{
+    std::string input = R"({"service": {"name": "checkout", "limits": {"cpu": 4, "memory": 2048}}, "routes": [)";
+    for (auto i = 0; i < 50; i++)
+    {
+        if (i)
+            input += ", ";
+        input += R"({"path": "/api/v1/resource)" + std::to_string(i) + R"(", "timeout": )" + std::to_string(100 + i) +
+                 R"(, "retries": 3, "methods": ["GET", "POST"]})";
+    }
+    input += "]";
+    for (auto i = 0; i < 30; i++)
+        input += R"(, "feature_flag_)" + std::to_string(i) + R"(": )" + (i % 2 ? "true" : "false");
+    input += "}";
+    return input;
+}
+
+// Reads a mix of nested members, array elements and absent keys.
+static std::int64_t lookups(const JSON &config, std::size_t count)
+{
+    std::vector<std::string> flags;
+    for (auto i = 0; i < 30; i++)
+        flags.push_back("feature_flag_" + std::to_string(i));
+
+    std::int64_t sum = 0;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        sum += config["service"]["limits"].at("cpu").getInt64();
+        sum += config.at("routes").at(i % 50).at("timeout").getInt64();
+        sum += config[flags[i % 30]].getBool();
+        sum += config.contains("missing");
+    }
+    return sum;
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const auto config = parse(makeInput());
+
+    std::printf("%-10s %10s %14s %8s\n", "threads", "seconds", "lookups/s", "scaling");
+
+    double single = 0;
+    std::vector<std::size_t> counts = {1, 2, 4, 8, 16, 32, 64};
+    auto hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (auto threads : counts)
+    {
+        if (threads > hardware)
+            break;
+
+        std::vector<std::thread> readers;
+        std::vector<std::int64_t> sums(threads);
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t t = 0; t < threads; t++)
+            readers.emplace_back([&, t]()
+                                 { sums[t] = lookups(config, count); });
+        for (auto &reader : readers)
+            reader.join();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        // Four lookups per iteration.
+        auto rate = 4.0 * count * threads / elapsed.count();
+        if (threads == 1)
+            single = rate;
+        std::printf("%-10zu %10.3f %14.0f %8.2f\n", threads, elapsed.count(), rate, rate / single);
+    }
+}
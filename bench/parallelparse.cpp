@@ -0,0 +1,75 @@
+// Compares the serial parser with the parallel parsing of a large top-level array.
+//
+// Usage: parallelparse [megabytes]
+//
+// The input is an array of small records, like a database export. Every configuration is
+// run a few times and the fastest run is reported.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../cppjson/cppjson.hpp"
+
+static std::string makeInput(std::size_t megabytes)
+{
+    std::string input = "[";
+    for (std::size_t i = 0; input.size() < megabytes * 1024 * 1024; i++)
+    {
+        if (i)
+            input += ",\n";
+        input += R"({"id": )" + std::to_string(i) +
+                 R"(, "name": "record \"number\" )" + std::to_string(i) +
+                 R"(", "score": )" + std::to_string(i % 1000) + ".25" +
+                 R"(, "tags": ["alpha", "beta, gamma", "[delta]"], "active": )" + (i % 2 ? "true" : "false") +
+                 R"(, "position": {"x": -12.5, "y": 3e-7, "z": null}})";
+    }
+    input += "]";
+    return input;
+}
+
+template <typename F>
+static double bestSeconds(F run)
+{
+    double best = 1e30;
+    for (auto i = 0; i < 3; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main(int argc, char **argv)
+{
+    std::size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    auto input = makeInput(megabytes);
+    auto size = static_cast<double>(input.size()) / (1024 * 1024);
+
+    std::size_t elements = 0;
+    auto serial = bestSeconds([&]()
+                              { elements = parse(input).getArray().size(); });
+    std::printf("input: %.0f MiB, %zu elements\n", size, elements);
+    std::printf("%-10s %10s %10s %8s\n", "threads", "seconds", "MiB/s", "speedup");
+    std::printf("%-10s %10.3f %10.0f %8.2f\n", "serial", serial, size / serial, 1.0);
+
+    std::vector<std::size_t> counts = {1, 2, 4, 8, 16, 32, 64};
+    auto hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (auto threads : counts)
+    {
+        if (threads > hardware)
+            break;
+
+        ParseOptions options;
+        options.threads = threads;
+        auto seconds = bestSeconds([&]()
+                                   { parse(input, options); });
+        std::printf("%-10zu %10.3f %10.0f %8.2f\n", threads, seconds, size / seconds, serial / seconds);
+    }
+}
@@ -1,279 +1,895 @@
-#include <string>
-#include <cassert>
-#include <stdexcept>
-#include <memory>
-
-#include "cppjson.hpp"
-
-/**
- * @brief The default constructor will construct an empty JSON object.
- * 
- */
-JSON::JSON() : _type(Object) {}
-
-/**
- * @brief  Construct a new JSON::JSON object holds a boolean.
- * 
- * @param val 
- */
-JSON::JSON(bool val) : _type(Bool), valBoolean(val) {}
-
-/**
- * @brief Construct a new JSON::JSON object holds a number.
- * 
- * @param val 
- */
-JSON::JSON(double val) : _type(Number), valNumber(val){};
-
-JSON::JSON(long val) : _type(Number), valNumber(static_cast<double>(val)){};
-/**
- * @brief Construct a new JSON::JSON object holds a string.
- * 
- * @param val 
- */
-JSON::JSON(std::string val) : _type(String), valString(val){};
-
-JSON::JSON(std::map<std::string, JSON> val) : _type(Object), valObject(val){};
-
-JSON::JSON(std::vector<JSON> val) : _type(Array), valArray(val){};
-
-JSON::JSON(const char *val) : _type(String), valString(val){};
-
-/**
- * @brief Construct a new JSON::JSON object holds a null value.
- * 
- * @param val 
- */
-JSON::JSON(nullptr_t val) : _type(Null){};
-
-/**
- * @brief Copy constructor
- * 
- * @param val 
- */
-JSON::JSON(const JSON &rhs)
-{
-    if (!rhs.isObject() || isObject())
-        valObject.empty();
-    if (!rhs.isArray() || isArray())
-        valArray.empty();
-
-    switch (rhs._type)
-    {
-    case Object:
-        valObject = rhs.valObject;
-        break;
-    case Array:
-        valArray = rhs.valArray;
-        break;
-    case String:
-        valString = rhs.valString;
-        break;
-    case Bool:
-        valBoolean = rhs.valBoolean;
-        break;
-    case Number:
-        valNumber = rhs.valNumber;
-        break;
-    }
-
-    _type = rhs._type;
-}
-
-JSON::JSON(JSON &&rhs) noexcept : JSON()
-{
-    swap(*this, rhs);
-}
-
-/* A series of methods return the _type of a JSON::JSON object. */
-
-bool JSON::isBoolean() const { return _type == Bool; };
-bool JSON::isNumber() const { return _type == Number; };
-bool JSON::isString() const { return _type == String; };
-bool JSON::isNull() const { return _type == Null; };
-bool JSON::isObject() const { return _type == Object; };
-bool JSON::isArray() const { return _type == Array; };
-
-JSON::Type JSON::type() const { return _type; }
-
-/* Entry-access methods for JSON::JSON objects represents JSON objects or arrays. */
-
-JSON &JSON::operator[](const std::string &s)
-{
-    if (isObject())
-    {
-        auto iter = valObject.find(s);
-        if (iter == valObject.end())
-        {
-            if (!absenceNode)
-            {
-                std::function<void()> setParentNode = [this, s]()
-                {
-                    this->valObject[s] = *this->absenceNode;
-                    this->absenceNode.reset();
-                };
-                absenceNode = std::unique_ptr<JSON>(new JSON(setParentNode));
-            }
-            return *absenceNode;
-        }
-        else
-        {
-            return iter->second;
-        }
-    }
-    else if (isArray())
-    {
-        throw std::logic_error("JSON array can only use operator[] with a positive integer argument.");
-    }
-    else
-    {
-        throw std::logic_error("Only JSON objects and arrays can use operator[].");
-    }
-};
-JSON &JSON::operator[](size_t idx)
-{
-    if (isArray())
-    {
-        if (idx < 0 || idx >= valArray.size())
-        {
-            throw std::out_of_range("input index is out of JSON array's range");
-        }
-        return valArray[idx];
-    }
-    else if (isObject())
-    {
-        throw std::logic_error("JSON object can only use operator[] with a string argument.");
-    }
-    else
-    {
-        throw std::logic_error("Only JSON objects and arrays can use operator[]");
-    }
-};
-
-/**
- * @brief Assignment operator, updates a JSON::JSON object's value.
- * 
- * @param val 
- * @return JSON& 
- */
-JSON &JSON::operator=(JSON rhs)
-{
-    if (setParentNodeFn)
-        setParentNodeFn();
-
-    swap(*this, rhs);
-    return *this;
-}
-
-// Methods that gets the wrapping value under a JSON::JSON object.
-// They should work only when the underlying value matches the returning _type.
-
-nullptr_t JSON::getNull() const
-{
-    if (_type == Null)
-        return nullptr;
-    throw std::logic_error("The value is not null");
-}
-
-double &JSON::getNumber()
-{
-    if (_type == Number)
-        return valNumber;
-    throw std::logic_error("The type is not number");
-}
-
-const double &JSON::getNumber() const
-{
-    return const_cast<const double &>(const_cast<JSON &>(*this).getNumber());
-}
-
-bool &JSON::getBool()
-{
-    if (_type == Bool)
-        return valBoolean;
-    throw std::logic_error("The type is not boolean");
-};
-
-const bool &JSON::getBool() const
-{
-    return const_cast<const bool &>(const_cast<JSON &>(*this).getBool());
-}
-
-std::string &JSON::getString()
-{
-    if (_type == String)
-        return valString;
-    throw std::logic_error("The type is not string");
-}
-
-const std::string &JSON::getString() const
-{
-    return const_cast<const std::string &>(const_cast<JSON &>(*this).getString());
-}
-
-std::vector<JSON> &JSON::getArray()
-{
-    if (_type == Array)
-        return valArray;
-    throw std::logic_error("The type is not array");
-}
-
-const std::vector<JSON> &JSON::getArray() const
-{
-    return const_cast<const std::vector<JSON> &>(const_cast<JSON &>(*this).getArray());
-}
-
-std::map<std::string, JSON> &JSON::getObject()
-{
-    if (_type == Object)
-        return valObject;
-    throw std::logic_error("The type is not object");
-}
-
-const std::map<std::string, JSON> &JSON::getObject() const
-{
-    return const_cast<const std::map<std::string, JSON> &>(const_cast<JSON &>(*this).getObject());
-}
-
-/**
- * @brief Get the size of an JSON::JSON array or an object. returns -1 if the object isn't.
- * 
- * @return size_t 
- */
-size_t JSON::size() const
-{
-    if (_type == Object)
-        return valObject.size();
-    else if (_type == Array)
-        return valArray.size();
-    else
-        return -1;
-}
-
-/* A static method create an empty JSON::JSON array */
-JSON JSON::array()
-{
-    JSON ret(std::vector<JSON>());
-    return ret;
-}
-
-JSON JSON::array(size_t sz)
-{
-    auto ret = array();
-    ret.valArray = std::vector<JSON>(sz, nullptr);
-    return ret;
-}
-
-void swap(JSON &first, JSON &second)
-{
-    using std::swap;
-
-    swap(first._type, second._type);
-    swap(first.valString, second.valString);
-    swap(first.valNumber, second.valNumber);
-    swap(first.valBoolean, second.valBoolean);
-    swap(first.valArray, second.valArray);
-    swap(first.valObject, second.valObject);
-    swap(first.setParentNodeFn, second.setParentNodeFn);
-    swap(first.absenceNode, second.absenceNode);
-}
+#include <string>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <memory>
+
+#include "cppjson.hpp"
+
+// Adds a reference to a shared heap representation.
+template <typename Rep>
+static Rep *acquire(Rep *rep)
+{
+    rep->refs.fetch_add(1, std::memory_order_relaxed);
+    return rep;
+}
+
+// Drops a reference, the last one destroys the representation. The decrement orders the
+// writes of every other owner before the destruction.
+template <typename Rep>
+static bool unref(Rep *rep)
+{
+    return rep->refs.fetch_sub(1, std::memory_order_acq_rel) == 1;
+}
+
+// Whether the representation has other owners, and must be copied before being modified.
+template <typename Rep>
+static bool isShared(Rep *rep)
+{
+    return rep->refs.load(std::memory_order_acquire) != 1;
+}
+
+/**
+ * @brief Heap representation of a string longer than `JSON::ShortStringCapacity`.
+ *
+ * The bytes follow the header in the same allocation and are NUL-terminated. Strings are
+ * immutable, so copies share the representation for good.
+ */
+struct JSON::StringRep
+{
+    std::atomic<std::size_t> refs;
+    std::size_t size;
+    char data[1];
+
+    static StringRep *create(const char *str, std::size_t len)
+    {
+        auto rep = new (::operator new(offsetof(StringRep, data) + len + 1)) StringRep;
+        rep->refs.store(1, std::memory_order_relaxed);
+        rep->size = len;
+        std::memcpy(rep->data, str, len);
+        rep->data[len] = '\0';
+        return rep;
+    }
+
+    static void release(StringRep *rep) noexcept
+    {
+        if (unref(rep))
+        {
+            rep->~StringRep();
+            ::operator delete(rep);
+        }
+    }
+};
+
+/**
+ * @brief Heap representation of a JSON array.
+ */
+struct JSON::ArrayRep
+{
+    std::atomic<std::size_t> refs{1};
+    // Whether the elements borrow strings from a buffer, e.g. of an in-situ parse. Copies
+    // of such an array can't share it, they may outlive the buffer.
+    bool borrows = false;
+    // Set once a mutable reference into the array has been handed out. Copies can't share
+    // it any more, since the reference may still modify it behind their back.
+    bool unshareable = false;
+    ArrayType items;
+
+    ArrayRep() = default;
+    explicit ArrayRep(std::pmr::memory_resource *resource) : items(resource) {}
+    explicit ArrayRep(const ArrayType &val) : items(val) {}
+    explicit ArrayRep(ArrayType &&val) : items(std::move(val)) {}
+};
+
+/**
+ * @brief Heap representation of a JSON object.
+ */
+struct JSON::ObjectRep
+{
+    std::atomic<std::size_t> refs{1};
+    // See `ArrayRep::borrows` and `ArrayRep::unshareable`.
+    bool borrows = false;
+    bool unshareable = false;
+    ObjectType members;
+
+    ObjectRep() = default;
+    explicit ObjectRep(std::pmr::memory_resource *resource) : members(resource) {}
+    explicit ObjectRep(const ObjectType &val) : members(val) {}
+    explicit ObjectRep(ObjectType &&val) : members(std::move(val)) {}
+    ObjectRep(const ObjectRep &rhs) : members(rhs.members) {}
+    ObjectRep &operator=(const ObjectRep &) = delete;
+};
+
+/**
+ * @brief The default constructor will construct an empty JSON object.
+ *
+ * An empty object doesn't allocate, its members are created on the first write.
+ */
+JSON::JSON()
+{
+    setType(Object);
+    store<ObjectRep *>(nullptr);
+}
+
+/**
+ * @brief  Construct a new JSON::JSON object holds a boolean.
+ *
+ * @param val
+ */
+JSON::JSON(bool val)
+{
+    setType(Bool);
+    store(val);
+}
+
+/**
+ * @brief Construct a new JSON::JSON object holds a number.
+ *
+ * @param val
+ */
+JSON::JSON(double val)
+{
+    setType(Number);
+    store(val);
+}
+
+/**
+ * @brief Construct a new JSON::JSON object holds an integer, which is stored exactly.
+ *
+ * @param val
+ */
+JSON::JSON(long long val)
+{
+    setType(Number, Int64);
+    store(static_cast<std::int64_t>(val));
+}
+
+JSON::JSON(unsigned long long val)
+{
+    if (val <= static_cast<unsigned long long>(INT64_MAX))
+    {
+        setType(Number, Int64);
+        store(static_cast<std::int64_t>(val));
+    }
+    else
+    {
+        setType(Number, Uint64);
+        store(static_cast<std::uint64_t>(val));
+    }
+}
+
+JSON::JSON(int val) : JSON(static_cast<long long>(val)) {}
+JSON::JSON(long val) : JSON(static_cast<long long>(val)) {}
+JSON::JSON(unsigned val) : JSON(static_cast<unsigned long long>(val)) {}
+JSON::JSON(unsigned long val) : JSON(static_cast<unsigned long long>(val)) {}
+
+/**
+ * @brief Construct a new JSON::JSON object holds a string.
+ *
+ * @param val
+ */
+JSON::JSON(std::string_view val)
+{
+    assignString(val.data(), val.size());
+}
+
+JSON::JSON(const std::string &val) : JSON(std::string_view(val)) {}
+
+JSON::JSON(const char *val) : JSON(std::string_view(val)) {}
+
+JSON::JSON(const ObjectType &val)
+{
+    setType(Object);
+    store(new ObjectRep(val));
+}
+
+JSON::JSON(ObjectType &&val)
+{
+    setType(Object);
+    store(new ObjectRep(std::move(val)));
+}
+
+JSON::JSON(const std::map<std::string, JSON> &val)
+{
+    auto rep = new ObjectRep();
+    for (auto &member : val)
+        rep->members.emplace(member.first, member.second);
+
+    setType(Object);
+    store(rep);
+}
+
+JSON::JSON(const ArrayType &val)
+{
+    setType(Array);
+    store(new ArrayRep(val));
+}
+
+JSON::JSON(ArrayType &&val)
+{
+    setType(Array);
+    store(new ArrayRep(std::move(val)));
+}
+
+JSON::JSON(const std::vector<JSON> &val)
+{
+    setType(Array);
+    store(new ArrayRep(ArrayType(val.begin(), val.end())));
+}
+
+JSON::JSON(std::vector<JSON> &&val)
+{
+    setType(Array);
+    store(new ArrayRep(ArrayType(std::make_move_iterator(val.begin()), std::make_move_iterator(val.end()))));
+}
+
+/**
+ * @brief Construct a new JSON::JSON object holds a null value.
+ *
+ * @param val
+ */
+JSON::JSON(std::nullptr_t val)
+{
+    setType(Null);
+}
+
+/**
+ * @brief Copy constructor, in O(1): the heap representation of `rhs`, if any, is shared.
+ *
+ * Storage borrowed from a document's arena or an input buffer can't be shared, since the
+ * copy may outlive them, so it is copied into storage of the copy's own. Interned strings
+ * are shared as is, their pool outlives both.
+ *
+ * @param val
+ */
+JSON::JSON(const JSON &rhs)
+{
+    if (rhs.isShareable())
+    {
+        std::memcpy(static_cast<void *>(this), &rhs, sizeof(JSON));
+        if (rhs._type == Object)
+        {
+            if (auto rep = load<ObjectRep *>())
+                acquire(rep);
+        }
+        else if (rhs._type == Array)
+            acquire(load<ArrayRep *>());
+        else
+            acquire(load<StringRep *>());
+        return;
+    }
+
+    switch (rhs._type)
+    {
+    case Object:
+        setType(Object);
+        store(new ObjectRep(*rhs.load<ObjectRep *>()));
+        break;
+    case Array:
+        setType(Array);
+        store(new ArrayRep(rhs.load<ArrayRep *>()->items));
+        break;
+    case String:
+    {
+        if (rhs._kind == Interned)
+        {
+            std::memcpy(static_cast<void *>(this), &rhs, sizeof(JSON));
+            break;
+        }
+        auto str = rhs.getString();
+        assignString(str.data(), str.size());
+        break;
+    }
+    default:
+        std::memcpy(static_cast<void *>(this), &rhs, sizeof(JSON));
+        break;
+    }
+}
+
+/**
+ * @brief Move constructor, steals the storage of `rhs` and leaves a null behind.
+ *
+ * @param rhs
+ */
+JSON::JSON(JSON &&rhs) noexcept
+{
+    if (rhs._type == Null)
+    {
+        setType(Null);
+        return;
+    }
+
+    std::memcpy(static_cast<void *>(this), &rhs, sizeof(JSON));
+    rhs.setType(Null);
+}
+
+JSON::~JSON()
+{
+    release();
+}
+
+/**
+ * @brief Frees the heap storage of the active alternative, if there is any.
+ */
+void JSON::release() noexcept
+{
+    if (_kind == Borrowed)
+        return;
+
+    switch (_type)
+    {
+    case String:
+        if (_kind == HeapString)
+            StringRep::release(load<StringRep *>());
+        break;
+    case Array:
+    {
+        auto rep = load<ArrayRep *>();
+        if (unref(rep))
+            delete rep;
+        break;
+    }
+    case Object:
+    {
+        auto rep = load<ObjectRep *>();
+        if (rep && unref(rep))
+            delete rep;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Whether copies of the value can share its heap representation.
+bool JSON::isShareable() const
+{
+    if (_kind == Borrowed)
+        return false;
+
+    switch (_type)
+    {
+    case String:
+        return _kind == HeapString;
+    case Array:
+    {
+        auto rep = load<ArrayRep *>();
+        return !rep->borrows && !rep->unshareable;
+    }
+    case Object:
+    {
+        auto rep = load<ObjectRep *>();
+        return !rep || (!rep->borrows && !rep->unshareable);
+    }
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Gives the array or object this value holds its own representation if it shares
+ * it with copies, so it can be modified without them seeing it. The elements or members are
+ * copied in O(1) each, so they stay shared until they are modified in turn.
+ *
+ * The caller hands out a mutable reference into the representation, so it is also marked
+ * unshareable: later copies take one of their own, like copy-on-write strings used to.
+ */
+void JSON::detach()
+{
+    if (_kind == Borrowed)
+        return;
+
+    if (_type == Array)
+    {
+        auto rep = load<ArrayRep *>();
+        if (isShared(rep))
+        {
+            auto copy = new ArrayRep(rep->items);
+            store(copy);
+            if (unref(rep))
+                delete rep;
+            rep = copy;
+        }
+        rep->unshareable = true;
+    }
+    else if (_type == Object)
+    {
+        auto rep = load<ObjectRep *>();
+        if (!rep)
+            return;
+        if (isShared(rep))
+        {
+            auto copy = new ObjectRep(*rep);
+            store(copy);
+            if (unref(rep))
+                delete rep;
+            rep = copy;
+        }
+        rep->unshareable = true;
+    }
+}
+
+void JSON::assignString(const char *str, std::size_t len)
+{
+    if (len <= ShortStringCapacity)
+    {
+        setType(String, static_cast<std::uint8_t>(len));
+        std::memcpy(storage, str, len);
+    }
+    else
+    {
+        setType(String, HeapString);
+        store(StringRep::create(str, len));
+    }
+}
+
+/**
+ * @brief Replaces the value with `str`. With an arena, a string that isn't stored inline
+ * is copied into the arena and borrowed from it.
+ */
+void JSON::makeString(std::string_view str, std::pmr::memory_resource *arena)
+{
+    release();
+
+    if (!arena || str.size() <= ShortStringCapacity || str.size() > UINT32_MAX)
+    {
+        assignString(str.data(), str.size());
+        return;
+    }
+
+    auto bytes = static_cast<char *>(arena->allocate(str.size(), 1));
+    std::memcpy(bytes, str.data(), str.size());
+    borrowString(std::string_view(bytes, str.size()));
+}
+
+/**
+ * @brief Replaces the value with a view of `str`, whose bytes must outlive the value.
+ * A string that fits inline is copied instead, since that costs nothing.
+ */
+void JSON::borrowString(std::string_view str)
+{
+    release();
+
+    if (str.size() <= ShortStringCapacity || str.size() > UINT32_MAX)
+    {
+        assignString(str.data(), str.size());
+        return;
+    }
+
+    setType(String, Borrowed);
+    store(str.data());
+    store(static_cast<std::uint32_t>(str.size()), sizeof(const char *));
+}
+
+/**
+ * @brief Replaces the value with an empty array and returns its elements. With an arena,
+ * the array and its elements are allocated from the arena.
+ */
+JSON::ArrayType &JSON::makeArray(std::pmr::memory_resource *arena, bool borrows)
+{
+    release();
+
+    ArrayRep *rep;
+    if (arena)
+    {
+        rep = new (arena->allocate(sizeof(ArrayRep), alignof(ArrayRep))) ArrayRep(arena);
+        setType(Array, Borrowed);
+    }
+    else
+    {
+        rep = new ArrayRep();
+        rep->borrows = borrows;
+        setType(Array);
+    }
+
+    store(rep);
+    return rep->items;
+}
+
+/**
+ * @brief Replaces the value with an empty object and returns its members. With an arena,
+ * the object, its keys and its members are allocated from the arena.
+ */
+JSON::ObjectType &JSON::makeObject(std::pmr::memory_resource *arena, bool borrows)
+{
+    release();
+
+    ObjectRep *rep;
+    if (arena)
+    {
+        rep = new (arena->allocate(sizeof(ObjectRep), alignof(ObjectRep))) ObjectRep(arena);
+        setType(Object, Borrowed);
+    }
+    else
+    {
+        rep = new ObjectRep();
+        rep->borrows = borrows;
+        setType(Object);
+    }
+
+    store(rep);
+    return rep->members;
+}
+
+// The elements or members of a value being built, which unlike `getArray()` and
+// `getObject()` leave the representation shareable: the builder is its only user.
+
+JSON::ArrayType &JSON::items()
+{
+    return load<ArrayRep *>()->items;
+}
+
+JSON::ObjectType &JSON::members()
+{
+    return load<ObjectRep *>()->members;
+}
+
+/* A series of methods return the _type of a JSON::JSON object. */
+
+bool JSON::isBoolean() const { return _type == Bool; };
+bool JSON::isNumber() const { return _type == Number; };
+bool JSON::isInteger() const { return _type == Number && _kind != Double; };
+bool JSON::isString() const { return _type == String; };
+bool JSON::isNull() const { return _type == Null; };
+bool JSON::isObject() const { return _type == Object; };
+bool JSON::isArray() const { return _type == Array; };
+
+JSON::Type JSON::type() const { return _type; }
+
+/* Entry-access methods for JSON::JSON objects represents JSON objects or arrays. */
+
+const JSON *JSON::find(std::string_view key) const
+{
+    if (_type != Object)
+        throw std::logic_error("The type is not object");
+
+    auto rep = load<ObjectRep *>();
+    if (!rep)
+        return nullptr;
+
+    auto iter = rep->members.find(key);
+    return iter != rep->members.end() ? &iter->second : nullptr;
+}
+
+const JSON &JSON::operator[](std::string_view key) const
+{
+    static const JSON null(nullptr);
+    auto member = find(key);
+    return member ? *member : null;
+}
+
+const JSON &JSON::operator[](size_t idx) const
+{
+    return at(idx);
+}
+
+const JSON &JSON::at(std::string_view key) const
+{
+    auto member = find(key);
+    if (!member)
+        throw std::out_of_range("The key is not in the object");
+    return *member;
+}
+
+const JSON &JSON::at(size_t idx) const
+{
+    auto &array = getArray();
+    if (idx >= array.size())
+        throw std::out_of_range("input index is out of JSON array's range");
+    return array[idx];
+}
+
+bool JSON::contains(std::string_view key) const
+{
+    return find(key) != nullptr;
+}
+
+JSON::Member JSON::operator[](std::string_view key)
+{
+    if (isObject())
+    {
+        return Member(this, nullptr, key, Member::NotAnIndex, find(key));
+    }
+    else if (isArray())
+    {
+        throw std::logic_error("JSON array can only use operator[] with a positive integer argument.");
+    }
+    else
+    {
+        throw std::logic_error("Only JSON objects and arrays can use operator[].");
+    }
+};
+JSON &JSON::operator[](size_t idx)
+{
+    if (isArray())
+    {
+        detach();
+        auto &array = load<ArrayRep *>()->items;
+        if (idx >= array.size())
+        {
+            throw std::out_of_range("input index is out of JSON array's range");
+        }
+        return array[idx];
+    }
+    else if (isObject())
+    {
+        throw std::logic_error("JSON object can only use operator[] with a string argument.");
+    }
+    else
+    {
+        throw std::logic_error("Only JSON objects and arrays can use operator[]");
+    }
+};
+
+/**
+ * @brief Assignment operator, updates a JSON::JSON object's value.
+ *
+ * `rhs` is taken by value, a copy costs O(1). The right operand of an assignment is
+ * evaluated first, so in `json["self"] = json` the copy is taken before `operator[]` makes
+ * `json` modifiable, which gives `json` a new representation instead of a cycle.
+ *
+ * @param val
+ * @return JSON&
+ */
+JSON &JSON::operator=(JSON rhs) noexcept
+{
+    swap(*this, rhs);
+    return *this;
+}
+
+/**
+ * @brief Assigns to the member, which is inserted first if it is missing, along with the
+ * missing members on the way to it. This is the only place a lookup through `operator[]`
+ * allocates.
+ *
+ * @param value
+ * @return JSON& the member
+ */
+JSON &JSON::Member::operator=(JSON value)
+{
+    if (index != NotAnIndex)
+    {
+        auto &element = container()[index];
+        this->value = &element;
+        return element = std::move(value);
+    }
+
+    auto &members = container().getObject();
+    auto iter = members.find(key);
+    if (iter == members.end())
+        iter = members.emplace(key, nullptr).first;
+    this->value = &iter->second;
+    return iter->second = std::move(value);
+}
+
+const JSON &JSON::Member::get() const
+{
+    static const JSON null(nullptr);
+    return value ? *value : null;
+}
+
+/**
+ * @brief Looks up a member of the member by reading only, like `JSON::operator[]`. A
+ * missing member has no members, which read as nulls.
+ */
+JSON::Member JSON::Member::operator[](std::string_view key)
+{
+    return Member(nullptr, this, key, NotAnIndex, value ? value->find(key) : nullptr);
+}
+
+/**
+ * @brief Looks up an element of the member by reading only. Throws `std::out_of_range` if
+ * the array has no such element.
+ */
+JSON::Member JSON::Member::operator[](size_t idx)
+{
+    return Member(nullptr, this, std::string_view(), idx, value ? &value->at(idx) : nullptr);
+}
+
+// Returns the object holding the member, through the non-const accessors, so the path to
+// it gets its own storage before it is modified. Only assignments get here with a missing
+// parent member, which is inserted as an empty object, e.g. by `json["a"]["b"] = 1`.
+JSON &JSON::Member::container()
+{
+    if (!parent)
+        return *object;
+    if (!parent->exists() && parent->index == NotAnIndex)
+        *parent = JSON();
+    return parent->existing();
+}
+
+// Returns the member for the accessors that modify it, which has to exist.
+JSON &JSON::Member::existing()
+{
+    if (!value)
+        throw std::logic_error("The member doesn't exist");
+
+    // The member found by reading may be shared, it is looked up again once its object
+    // can be modified.
+    if (index != NotAnIndex)
+    {
+        auto &element = container()[index];
+        value = &element;
+        return element;
+    }
+
+    auto &members = container().getObject();
+    auto &member = members.find(key)->second;
+    value = &member;
+    return member;
+}
+
+// Methods that gets the wrapping value under a JSON::JSON object.
+// They should work only when the underlying value matches the returning _type.
+
+std::nullptr_t JSON::getNull() const
+{
+    if (_type == Null)
+        return nullptr;
+    throw std::logic_error("The value is not null");
+}
+
+double JSON::getNumber() const
+{
+    if (_type != Number)
+        throw std::logic_error("The type is not number");
+
+    switch (_kind)
+    {
+    case Int64:
+        return static_cast<double>(load<std::int64_t>());
+    case Uint64:
+        return static_cast<double>(load<std::uint64_t>());
+    default:
+        return load<double>();
+    }
+}
+
+// The integer getters also accept a double holding an integer, like 1e3. They throw
+// `std::out_of_range` if the number isn't representable in the returned type.
+
+std::int64_t JSON::getInt64() const
+{
+    if (_type != Number)
+        throw std::logic_error("The type is not number");
+
+    if (_kind == Int64)
+        return load<std::int64_t>();
+
+    if (_kind == Double)
+    {
+        auto val = load<double>();
+        // 2^63 is exactly representable, unlike INT64_MAX.
+        if (val >= -9223372036854775808.0 && val < 9223372036854775808.0 && static_cast<double>(static_cast<std::int64_t>(val)) == val)
+            return static_cast<std::int64_t>(val);
+    }
+    throw std::out_of_range("The number is not representable as an int64");
+}
+
+std::uint64_t JSON::getUint64() const
+{
+    if (_type != Number)
+        throw std::logic_error("The type is not number");
+
+    if (_kind == Uint64)
+        return load<std::uint64_t>();
+
+    if (_kind == Int64 && load<std::int64_t>() >= 0)
+        return static_cast<std::uint64_t>(load<std::int64_t>());
+
+    if (_kind == Double)
+    {
+        auto val = load<double>();
+        if (val >= 0 && val < 18446744073709551616.0 && static_cast<double>(static_cast<std::uint64_t>(val)) == val)
+            return static_cast<std::uint64_t>(val);
+    }
+    throw std::out_of_range("The number is not representable as an uint64");
+}
+
+bool JSON::getBool() const
+{
+    if (_type == Bool)
+        return load<bool>();
+    throw std::logic_error("The type is not boolean");
+};
+
+std::string_view JSON::getString() const
+{
+    if (_type != String)
+        throw std::logic_error("The type is not string");
+
+    if (_kind == HeapString)
+    {
+        auto rep = load<StringRep *>();
+        return std::string_view(rep->data, rep->size);
+    }
+    else if (_kind == Borrowed || _kind == Interned)
+    {
+        return std::string_view(load<const char *>(), load<std::uint32_t>(sizeof(const char *)));
+    }
+    return std::string_view(storage, _kind);
+}
+
+JSON::ArrayType &JSON::getArray()
+{
+    if (_type != Array)
+        throw std::logic_error("The type is not array");
+
+    detach();
+    return load<ArrayRep *>()->items;
+}
+
+const JSON::ArrayType &JSON::getArray() const
+{
+    if (_type != Array)
+        throw std::logic_error("The type is not array");
+    return load<ArrayRep *>()->items;
+}
+
+JSON::ObjectType &JSON::getObject()
+{
+    if (_type != Object)
+        throw std::logic_error("The type is not object");
+
+    detach();
+    auto rep = load<ObjectRep *>();
+    if (!rep)
+    {
+        rep = new ObjectRep();
+        rep->unshareable = true;
+        store(rep);
+    }
+    return rep->members;
+}
+
+const JSON::ObjectType &JSON::getObject() const
+{
+    static const ObjectType empty;
+
+    if (_type != Object)
+        throw std::logic_error("The type is not object");
+
+    auto rep = load<ObjectRep *>();
+    return rep ? rep->members : empty;
+}
+
+/**
+ * @brief Get the size of an JSON::JSON array or an object. returns -1 if the object isn't.
+ *
+ * @return size_t
+ */
+size_t JSON::size() const
+{
+    if (_type == Object)
+        return getObject().size();
+    else if (_type == Array)
+        return getArray().size();
+    else
+        return -1;
+}
+
+/* A static method create an empty JSON::JSON array */
+JSON JSON::array()
+{
+    return JSON(ArrayType());
+}
+
+JSON JSON::array(size_t sz)
+{
+    return JSON(ArrayType(sz, JSON(nullptr)));
+}
+
+/**
+ * @brief Swaps two values. Every alternative is trivially relocatable, so only the
+ * 16 bytes of each value are exchanged, the heap storage never moves.
+ */
+void swap(JSON &first, JSON &second) noexcept
+{
+    alignas(JSON) char tmp[sizeof(JSON)];
+    std::memcpy(tmp, &first, sizeof(JSON));
+    std::memcpy(static_cast<void *>(&first), &second, sizeof(JSON));
+    std::memcpy(static_cast<void *>(&second), tmp, sizeof(JSON));
+}
@@ -1,101 +1,807 @@
-#ifndef CPP_JSON
-#define CPP_JSON
-
-#include <string>
-#include <vector>
-#include <map>
-#include <memory>
-#include <functional>
-#include <stdexcept>
-
-class SyntaxError : std::logic_error
-{
-public:
-    SyntaxError() : std::logic_error("JSON syntax error") {}
-};
-
-class JSON
-{
-public:
-    enum Type
-    {
-        Bool,
-        Number,
-        String,
-        Null,
-        Object,
-        Array,
-    };
-
-private:
-    Type _type;
-
-    std::string valString;
-    double valNumber;
-    bool valBoolean;
-    std::vector<JSON> valArray;
-    std::map<std::string, JSON> valObject;
-
-    std::unique_ptr<JSON> absenceNode;
-    std::function<void()> setParentNodeFn;
-
-    JSON(std::function<void()> setParentCallback) : setParentNodeFn(setParentCallback){};
-
-public:
-    JSON();
-    JSON(std::string val);
-    JSON(std::map<std::string, JSON> val);
-    JSON(std::vector<JSON> val);
-    JSON(const char *str);
-    JSON(const JSON &val);
-    JSON(nullptr_t val);
-    JSON(bool val);
-    JSON(double val);
-    JSON(long val);
-    JSON(JSON &&rhs)
-    noexcept;
-
-    bool isBoolean() const;
-    bool isNumber() const;
-    bool isString() const;
-    bool isNull() const;
-    bool isObject() const;
-    bool isArray() const;
-
-    Type type() const;
-
-    JSON &operator[](const std::string &s);
-    JSON &operator[](size_t idx);
-
-    JSON &operator=(const JSON val);
-
-    bool &getBool();
-    const bool &getBool() const;
-
-    double &getNumber();
-    const double &getNumber() const;
-
-    nullptr_t getNull() const;
-
-    std::string &getString();
-    const std::string &getString() const;
-
-    std::vector<JSON> &getArray();
-    const std::vector<JSON> &getArray() const;
-
-    std::map<std::string, JSON> &getObject();
-    const std::map<std::string, JSON> &getObject() const;
-
-    size_t size() const;
-
-    static JSON array();
-    static JSON array(size_t sz);
-
-    friend void swap(JSON &first, JSON &second);
-};
-
-std::string toString(const JSON &json);
-JSON parse(const std::string &str);
-void swap(JSON &first, JSON &second);
-
-#endif
\ No newline at end of file
+#ifndef CPP_JSON
+#define CPP_JSON
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <functional>
+#include <initializer_list>
+#include <optional>
+#include <atomic>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <tuple>
+#include <utility>
+
+class SyntaxError : std::logic_error
+{
+public:
+    SyntaxError() : std::logic_error("JSON syntax error") {}
+};
+
+class KeyPool;
+
+class JSON
+{
+public:
+    enum Type : std::uint8_t
+    {
+        Bool,
+        Number,
+        String,
+        Null,
+        Object,
+        Array,
+    };
+
+    class Key;
+    class ObjectMap;
+    class Member;
+
+    // Containers take a memory resource, so the values of a `JSON::Document` can keep
+    // all of their storage in the document's arena.
+    using ArrayType = std::pmr::vector<JSON>;
+    using ObjectType = ObjectMap;
+
+    class Document;
+    class MappedDocument;
+    class LazyDocument;
+    class LazyValue;
+
+    // Strings up to this many bytes are stored inline, without a heap allocation.
+    static constexpr std::size_t ShortStringCapacity = 14;
+
+private:
+    // The parsers build values in place.
+    friend class Parser;
+    friend class Tape;
+    friend class ProjectedParser;
+    friend JSON parseParallel(std::string_view input, std::size_t threads, KeyPool *keys);
+
+    struct StringRep;
+    struct ArrayRep;
+    struct ObjectRep;
+
+    // A JSON value is a 16-byte discriminated union. `_type` tells which alternative
+    // is active, `_kind` refines how it is stored (e.g. the length of an inline string),
+    // and `storage` holds the scalar itself, the bytes of a short string, or a pointer
+    // to the heap representation of a long string, an array or an object.
+    //
+    // Heap representations are reference counted and shared by copies, so copying is O(1).
+    // The accessors returning a mutable reference into an array or an object, `getArray()`,
+    // `getObject()`, `operator[](size_t)`, and assignments through `operator[](key)`, first
+    // give the value its own copy if it is shared, which clones only the path being
+    // modified. Lookups by key only read. The counts are atomic, so copies of one value can
+    // be used from different threads.
+    //
+    // The const accessors never modify anything, so any number of threads can read one
+    // value at once, as long as none of them modifies it. Shared representations are only
+    // read by them, and reference counts only change through copies, atomically.
+    //
+    // A representation one of those accessors has handed out a reference into is no longer
+    // shared: the reference may still modify it, so later copies take their own one level
+    // deep. That also makes `json.getArray().push_back(json)` add a copy, not a cycle.
+    //
+    // Values are read from and written to `storage` through `load` and `store`, which
+    // copy the bytes with `std::memcpy` so that no alignment or aliasing rule is broken.
+    alignas(8) char storage[ShortStringCapacity];
+    std::uint8_t _kind;
+    Type _type;
+
+    enum Kind : std::uint8_t
+    {
+        // For strings, kinds 0 to ShortStringCapacity are the length of an inline string.
+        HeapString = 0xFF,
+        // The string bytes or the container are owned by someone else, e.g. the arena of a
+        // `JSON::Document`, and are not freed with the value. A borrowed string stores its
+        // pointer followed by a 32-bit length.
+        Borrowed = 0xFE,
+        // The string bytes belong to a `KeyPool`, which outlives the value. Unlike a
+        // borrowed string, a copy shares them too.
+        Interned = 0xFD,
+        // For numbers, how the value is stored. Integers are stored as an int64, unless they
+        // are only representable as an uint64.
+        Double = 0x00,
+        Int64 = 0x01,
+        Uint64 = 0x02,
+    };
+
+    template <typename T>
+    T load(std::size_t offset = 0) const
+    {
+        T val;
+        std::memcpy(&val, storage + offset, sizeof(T));
+        return val;
+    }
+
+    template <typename T>
+    void store(T val, std::size_t offset = 0)
+    {
+        std::memcpy(storage + offset, &val, sizeof(T));
+    }
+
+    void setType(Type type, std::uint8_t kind = 0)
+    {
+        _type = type;
+        _kind = kind;
+    }
+
+    void assignString(const char *str, std::size_t len);
+    void release() noexcept;
+    bool isShareable() const;
+    void detach();
+
+    // Used by the parser to build a value in place. With an arena, the storage is
+    // allocated from it and the value is marked as borrowed. A container that will hold
+    // borrowed strings is made with `borrows`, so copies don't share it.
+    void makeString(std::string_view str, std::pmr::memory_resource *arena);
+    void borrowString(std::string_view str);
+    ArrayType &makeArray(std::pmr::memory_resource *arena, bool borrows = false);
+    ObjectType &makeObject(std::pmr::memory_resource *arena, bool borrows = false);
+    ArrayType &items();
+    ObjectType &members();
+
+public:
+    JSON();
+    JSON(const std::string &val);
+    JSON(std::string_view val);
+    JSON(const ObjectType &val);
+    JSON(ObjectType &&val);
+    JSON(const std::map<std::string, JSON> &val);
+    JSON(const ArrayType &val);
+    JSON(ArrayType &&val);
+    JSON(const std::vector<JSON> &val);
+    JSON(std::vector<JSON> &&val);
+    JSON(const char *str);
+    JSON(const JSON &val);
+    JSON(std::nullptr_t val);
+    JSON(bool val);
+    JSON(double val);
+    JSON(int val);
+    JSON(long val);
+    JSON(long long val);
+    JSON(unsigned val);
+    JSON(unsigned long val);
+    JSON(unsigned long long val);
+    JSON(JSON &&rhs) noexcept;
+    ~JSON();
+
+    bool isBoolean() const;
+    bool isNumber() const;
+    bool isInteger() const;
+    bool isString() const;
+    bool isNull() const;
+    bool isObject() const;
+    bool isArray() const;
+
+    Type type() const;
+
+    // Looks up a member of an object, without allocating. Returns null if there is none.
+    // It only reads, so it keeps the object shared with its copies.
+    const JSON *find(std::string_view key) const;
+
+    Member operator[](std::string_view key);
+    JSON &operator[](size_t idx);
+
+    // The read-only accessors, safe to call from several threads at once. `operator[]`
+    // reads a missing member as a null, `at` throws `std::out_of_range` instead. Objects
+    // and arrays are iterated through `getObject()` and `getArray()`.
+    const JSON &operator[](std::string_view key) const;
+    const JSON &operator[](size_t idx) const;
+    const JSON &at(std::string_view key) const;
+    const JSON &at(size_t idx) const;
+    bool contains(std::string_view key) const;
+
+    JSON &operator=(JSON rhs) noexcept;
+
+    bool getBool() const;
+
+    double getNumber() const;
+    std::int64_t getInt64() const;
+    std::uint64_t getUint64() const;
+
+    std::nullptr_t getNull() const;
+
+    std::string_view getString() const;
+
+    ArrayType &getArray();
+    const ArrayType &getArray() const;
+
+    ObjectType &getObject();
+    const ObjectType &getObject() const;
+
+    size_t size() const;
+
+    static JSON array();
+    static JSON array(size_t sz);
+
+    friend void swap(JSON &first, JSON &second) noexcept;
+};
+
+static_assert(sizeof(JSON) == 16, "JSON values are expected to be 16 bytes");
+
+/**
+ * @brief The key of an object member. Like a string value, it is stored inline up to
+ * `ShortStringCapacity` bytes, otherwise on the heap, in the arena of a document, or
+ * shared from a `KeyPool`.
+ */
+class JSON::Key
+{
+public:
+    explicit Key(std::string_view key, std::pmr::memory_resource *arena = nullptr);
+    // Shares the pooled copy of a key too long to be stored inline.
+    Key(std::string_view key, KeyPool &pool);
+
+    std::string_view view() const { return value.getString(); }
+    operator std::string_view() const { return view(); }
+    const char *data() const { return view().data(); }
+    std::size_t size() const { return view().size(); }
+    bool isInterned() const { return value._kind == Interned; }
+
+    friend bool operator==(const Key &lhs, std::string_view rhs) { return lhs.view() == rhs; }
+    friend bool operator==(std::string_view lhs, const Key &rhs) { return lhs == rhs.view(); }
+    friend bool operator!=(const Key &lhs, std::string_view rhs) { return lhs.view() != rhs; }
+    friend bool operator!=(std::string_view lhs, const Key &rhs) { return lhs != rhs.view(); }
+
+private:
+    JSON value;
+};
+
+/**
+ * @brief The members of a JSON object, in insertion order.
+ *
+ * Keys and values are stored side by side in one vector, so iterating is a linear walk and
+ * a small object is searched with a linear scan. An object of more than `IndexThreshold`
+ * members also gets a hash index, an open-addressing table of positions in the vector.
+ *
+ * The interface follows `std::map`, but like a vector's, inserting may move the members
+ * and invalidate references to them. Erasing keeps the order and takes linear time. Keys
+ * are compared by address first, so looking up an interned key in an object whose keys
+ * come from the same `KeyPool` finds it without comparing bytes.
+ */
+class JSON::ObjectMap
+{
+public:
+    using key_type = Key;
+    using mapped_type = JSON;
+    using value_type = std::pair<Key, JSON>;
+    using size_type = std::size_t;
+    using iterator = std::pmr::vector<value_type>::iterator;
+    using const_iterator = std::pmr::vector<value_type>::const_iterator;
+
+    static constexpr std::size_t IndexThreshold = 8;
+
+    ObjectMap() = default;
+    // The members, the index and the keys are allocated from `resource`.
+    explicit ObjectMap(std::pmr::memory_resource *resource) : entries(resource), index(resource), arena(resource) {}
+    // A copy always owns its storage, like a copied `JSON`.
+    ObjectMap(const ObjectMap &rhs) : entries(rhs.entries), index(rhs.index) {}
+    ObjectMap(ObjectMap &&rhs) = default;
+    ObjectMap &operator=(const ObjectMap &rhs);
+    ObjectMap &operator=(ObjectMap &&rhs) = default;
+
+    iterator begin() { return entries.begin(); }
+    iterator end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+
+    bool empty() const { return entries.empty(); }
+    size_type size() const { return entries.size(); }
+    void reserve(size_type count) { entries.reserve(count); }
+    void clear();
+
+    iterator find(std::string_view key);
+    const_iterator find(std::string_view key) const;
+    // Looks `key` up with its hash computed beforehand by `hash()`, e.g. once for a key
+    // that is looked up in many objects.
+    iterator find(std::string_view key, std::uint64_t hash);
+    const_iterator find(std::string_view key, std::uint64_t hash) const;
+    static std::uint64_t hash(std::string_view key);
+    size_type count(std::string_view key) const;
+    bool contains(std::string_view key) const;
+    JSON &at(std::string_view key);
+    const JSON &at(std::string_view key) const;
+
+    // Inserts a value constructed from `args` unless `key` is already there, and returns
+    // the member and whether it was inserted.
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(std::string_view key, Args &&...args)
+    {
+        // The value is built first, `args` may refer to a member that inserting moves.
+        return insert(key, JSON(std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Key key, Args &&...args)
+    {
+        return insert(std::move(key), JSON(std::forward<Args>(args)...));
+    }
+
+    // Inserts an empty object if `key` isn't there, like `std::map`.
+    JSON &operator[](std::string_view key);
+
+    iterator erase(const_iterator position);
+    size_type erase(std::string_view key);
+
+private:
+    std::pmr::vector<value_type> entries;
+    // Empty slots are 0, the others hold the position of an entry plus one in their low 32
+    // bits and the high 32 bits of its key's hash above, which rejects most mismatches
+    // without comparing the keys.
+    std::pmr::vector<std::uint64_t> index;
+    // The arena new keys are copied into, if any.
+    std::pmr::memory_resource *arena = nullptr;
+
+    std::pair<iterator, bool> insert(std::string_view key, JSON &&value);
+    std::pair<iterator, bool> insert(Key &&key, JSON &&value);
+    iterator append(Key &&key, JSON &&value, std::uint64_t hash);
+    std::size_t findPosition(std::string_view key, std::uint64_t &hash) const;
+    std::size_t probe(std::string_view key, std::uint64_t hash) const;
+    void indexEntry(std::size_t position, std::uint64_t hash);
+    void rebuildIndex();
+};
+
+/**
+ * @brief A parsed JSON value whose nodes, string bytes and container storage all live in
+ * one monotonic arena owned by the document.
+ *
+ * Destroying or resetting the document frees the whole tree in a single step instead of
+ * walking it node by node. A document can be reset and reused for the next input, which
+ * keeps its initial block. The tree is read-only, copy `root()` into a `JSON` to modify it.
+ */
+class JSON::Document
+{
+public:
+    static constexpr std::size_t DefaultBlockSize = 64 * 1024;
+
+    explicit Document(std::size_t initialBlockSize = DefaultBlockSize);
+    Document(const Document &) = delete;
+    Document &operator=(const Document &) = delete;
+    ~Document();
+
+    const JSON &parse(std::string_view str);
+    const JSON &root() const;
+    void reset();
+
+private:
+    std::unique_ptr<char[]> initialBlock;
+    std::pmr::monotonic_buffer_resource arena;
+    std::string buffer;
+    JSON _root;
+};
+
+/**
+ * @brief A file mapped read-only into memory and parsed straight from the mapping.
+ *
+ * Strings without escape sequences stay views into the mapping, the other values are
+ * allocated in an arena like a `JSON::Document`'s, so the file is never copied and the
+ * tree is freed at once. The tree is read-only and lives as long as the document.
+ *
+ * Throws `std::system_error` if the file can't be read, and `SyntaxError` if it isn't JSON.
+ */
+class JSON::MappedDocument
+{
+public:
+    explicit MappedDocument(const std::string &path);
+    MappedDocument(const MappedDocument &) = delete;
+    MappedDocument &operator=(const MappedDocument &) = delete;
+    ~MappedDocument();
+
+    const JSON &root() const;
+    // The content of the file.
+    std::string_view bytes() const;
+
+private:
+    struct Mapping;
+    std::unique_ptr<Mapping> mapping;
+    std::pmr::monotonic_buffer_resource arena;
+    std::string buffer;
+    JSON _root;
+};
+
+/**
+ * @brief A document that is only indexed up front, and decoded as it is accessed.
+ *
+ * The constructor finds the structural characters of the input with the tape engine's
+ * vectorized first stage and matches the brackets, which checks that strings are closed
+ * and containers balanced. Values are then reached through `root()`, with the same
+ * accessors as `JSON`, and only the strings and numbers that are read are decoded. Skipping
+ * a container on the way is a single jump to its closing bracket.
+ *
+ * The rest of the grammar is checked as the values are accessed, so an error in a value
+ * nobody reads goes unnoticed. `input` must outlive the document and its values, which
+ * are small handles into it. A document isn't safe to use from several threads.
+ */
+class JSON::LazyDocument
+{
+public:
+    explicit LazyDocument(std::string_view input);
+    LazyDocument(const LazyDocument &) = delete;
+    LazyDocument &operator=(const LazyDocument &) = delete;
+    ~LazyDocument();
+
+    LazyValue root() const;
+
+private:
+    friend class LazyValue;
+
+    std::string_view input;
+    // The positions of the structural characters, see `buildStructuralIndex()`.
+    std::vector<std::uint32_t> positions;
+    // For every bracket opening a container, the index of its closing bracket.
+    std::vector<std::uint32_t> matches;
+    // Strings with escape sequences, decoded the first time they are read, by the index
+    // of their structural character.
+    mutable std::unordered_map<std::size_t, std::string> decoded;
+    mutable std::string buffer;
+};
+
+/**
+ * @brief A value of a `JSON::LazyDocument`, decoded when it is read.
+ *
+ * Accessing a missing key or an index out of range throws `std::out_of_range`, accessing a
+ * value of another type throws `std::logic_error`, and a syntax error found on the way
+ * throws `SyntaxError`.
+ */
+class JSON::LazyValue
+{
+public:
+    Type type() const;
+    bool isBoolean() const;
+    bool isNumber() const;
+    bool isString() const;
+    bool isNull() const;
+    bool isArray() const;
+    bool isObject() const;
+
+    LazyValue operator[](std::string_view key) const;
+    LazyValue operator[](std::size_t index) const;
+    bool contains(std::string_view key) const;
+    std::size_t size() const;
+
+    bool getBool() const;
+    double getNumber() const;
+    std::int64_t getInt64() const;
+    std::uint64_t getUint64() const;
+    std::nullptr_t getNull() const;
+    std::string_view getString() const;
+
+    // Decodes the whole value.
+    JSON toJSON() const;
+
+private:
+    friend class LazyDocument;
+
+    LazyValue(const LazyDocument *document, std::uint32_t index) : document(document), index(index) {}
+
+    const LazyDocument *document;
+    // The index of the value's first structural character.
+    std::uint32_t index;
+
+    char first() const;
+    std::uint32_t next(std::uint32_t value) const;
+    bool findMember(std::string_view key, std::uint32_t &value) const;
+    JSON number() const;
+};
+
+/**
+ * @brief What `JSON::operator[]` returns for a key: the member if the object has it, or
+ * the place to insert it otherwise. Looking up an element of such a member by its index
+ * returns a proxy too, which reads the element the same way.
+ *
+ * Reading a missing member reads a null, and nothing is inserted until something is
+ * assigned to it, so looking up an absent key doesn't allocate. Reads don't modify the
+ * object either, so it stays shared with its copies: only an assignment or one of the
+ * accessors returning a mutable reference gives the path to the member its own storage.
+ *
+ * The proxy views the key it was given, and the proxy it was looked up from for a member
+ * of a member, so it is meant to be used within the expression that made it, e.g.
+ * `json["a"]["b"] = 1` or `json["name"].getString()`.
+ */
+class JSON::Member
+{
+public:
+    // Assigns to the member, inserting it if it is missing. A missing member it was looked
+    // up in is inserted as an empty object first, a missing array element isn't.
+    JSON &operator=(JSON value);
+    JSON &operator=(const Member &rhs) { return *this = JSON(rhs.get()); }
+
+    bool exists() const { return value != nullptr; }
+    // The member, or a null if it is missing.
+    const JSON &get() const;
+    operator const JSON &() const { return get(); }
+
+    bool isBoolean() const { return get().isBoolean(); }
+    bool isNumber() const { return get().isNumber(); }
+    bool isInteger() const { return get().isInteger(); }
+    bool isString() const { return get().isString(); }
+    bool isNull() const { return get().isNull(); }
+    bool isObject() const { return get().isObject(); }
+    bool isArray() const { return get().isArray(); }
+    Type type() const { return get().type(); }
+
+    bool getBool() const { return get().getBool(); }
+    double getNumber() const { return get().getNumber(); }
+    std::int64_t getInt64() const { return get().getInt64(); }
+    std::uint64_t getUint64() const { return get().getUint64(); }
+    std::nullptr_t getNull() const { return get().getNull(); }
+    std::string_view getString() const { return get().getString(); }
+    size_t size() const { return get().size(); }
+
+    const JSON *find(std::string_view key) const { return get().find(key); }
+    Member operator[](std::string_view key);
+    Member operator[](size_t idx);
+
+    // The accessors below may modify the member, which must exist.
+    ArrayType &getArray() { return existing().getArray(); }
+    ObjectType &getObject() { return existing().getObject(); }
+
+private:
+    friend class JSON;
+
+    static constexpr std::size_t NotAnIndex = SIZE_MAX;
+
+    Member(JSON *object, Member *parent, std::string_view key, std::size_t index, const JSON *value)
+        : object(object), parent(parent), key(key), index(index), value(value) {}
+
+    // The object holding the member, or the proxy of that object or array for a member of
+    // a member or an element of a member.
+    JSON *object;
+    Member *parent;
+    // The key of the member, or the index of the element if it isn't `NotAnIndex`.
+    std::string_view key;
+    std::size_t index;
+    // The member as found by reading, which may still be shared with copies.
+    const JSON *value;
+
+    JSON &container();
+    JSON &existing();
+};
+
+/**
+ * @brief An RFC 6901 JSON Pointer, e.g. `/items/3/price`, compiled once to be evaluated
+ * against many documents.
+ *
+ * The pointer is split into its reference tokens up front, with `~1` and `~0` unescaped,
+ * the hash of every token computed for object lookups, and the tokens that are array
+ * indices parsed. The empty pointer refers to the whole document.
+ *
+ * `find()` follows the pointer through a tree. `extract()` follows it through raw JSON
+ * text instead, skipping every member and element off the path without decoding it, and
+ * parses only the value it points to. Only the part of the text on the path is checked, and
+ * of duplicated keys the first one is followed.
+ *
+ * The constructor throws `std::invalid_argument` for a string that isn't a JSON Pointer.
+ */
+class JSONPointer
+{
+public:
+    explicit JSONPointer(std::string_view pointer);
+
+    // Returns the value the pointer refers to, or null if there is none. Like `JSON::find()`,
+    // the non-const overload gives the objects and arrays on the path their own storage.
+    const JSON *find(const JSON &root) const;
+    JSON *find(JSON &root) const;
+
+    // Returns the value the pointer refers to in `input`, or nothing if there is none.
+    std::optional<JSON> extract(std::string_view input) const;
+
+    // The unescaped reference tokens.
+    std::size_t size() const { return tokens.size(); }
+    std::string_view operator[](std::size_t index) const { return tokens[index].name; }
+
+private:
+    struct Token
+    {
+        std::string name;
+        std::uint64_t hash;
+        // The array index the token stands for, or `NotAnIndex`.
+        std::size_t index;
+    };
+
+    static constexpr std::size_t NotAnIndex = SIZE_MAX;
+
+    std::vector<Token> tokens;
+};
+
+/**
+ * @brief A pool of object keys, shared by every document parsed with it.
+ *
+ * A parse given a pool stores every key too long to be inline as a view of its pooled copy,
+ * so a key repeated across documents is allocated once. The pool only grows, it must
+ * outlive the values parsed with it and their copies. It is safe to use from several
+ * threads, e.g. by a parallel parse.
+ *
+ * Keys of up to `JSON::ShortStringCapacity` bytes are stored inline, which costs no
+ * allocation, and bypass the pool: they aren't counted by `stats()`, which only measures
+ * the longer keys. Two pooled keys are equal when their addresses are, but a lookup by a
+ * `std::string_view`, e.g. `find("name")`, still compares the strings.
+ */
+class KeyPool
+{
+public:
+    struct Stats
+    {
+        // The number of keys looked up, and how many of them were already pooled, among
+        // the keys too long to be inline.
+        std::size_t lookups;
+        std::size_t hits;
+        // The number of distinct keys, and the bytes they take.
+        std::size_t keys;
+        std::size_t bytes;
+
+        double hitRate() const { return lookups ? static_cast<double>(hits) / lookups : 0; }
+    };
+
+    KeyPool();
+    KeyPool(const KeyPool &) = delete;
+    KeyPool &operator=(const KeyPool &) = delete;
+    ~KeyPool();
+
+    // Returns the pooled copy of `key`, adding it on first use.
+    std::string_view intern(std::string_view key);
+    Stats stats() const;
+
+    // A pool that lives as long as the program.
+    static KeyPool &global();
+
+private:
+    mutable std::shared_mutex mutex;
+    std::pmr::monotonic_buffer_resource arena;
+    std::unordered_set<std::string_view> keys;
+    std::size_t bytes = 0;
+    std::atomic<std::size_t> lookups{0};
+    std::atomic<std::size_t> hits{0};
+};
+
+/**
+ * @brief The parts of the input a parse keeps, see `ParseOptions::projection`.
+ *
+ * Every path is a JSON Pointer, e.g. `/user/id`, or a single top-level key, e.g. `user`.
+ * Paths step through object members only, an array on the way is kept with each of its
+ * elements projected the same way, so `/items/price` keeps the price of every item. The
+ * value a path ends at is kept whole, and the empty pointer keeps everything.
+ *
+ * Members off every path are skipped at scanning speed, their strings and numbers aren't
+ * decoded and nothing is allocated for them, but only their structure is checked.
+ */
+class Projection
+{
+public:
+    Projection() = default;
+    Projection(std::initializer_list<std::string_view> paths);
+    explicit Projection(const std::vector<std::string> &paths);
+
+    void add(std::string_view path);
+
+private:
+    friend JSON parseProjected(std::string_view input, const Projection &projection, KeyPool *keys);
+
+    struct Node
+    {
+        std::string name;
+        // Whether a path ends here, so the value is kept whole.
+        bool keep = false;
+        std::vector<Node> children;
+    };
+
+    Node root;
+};
+
+enum class ParseEngine
+{
+    // Recursive descent over the input, character by character.
+    RecursiveDescent,
+    // Indexes the structural characters of the whole input with vector instructions first,
+    // then walks the index to build a flat tape that is converted to a JSON value.
+    Tape,
+};
+
+struct ParseOptions
+{
+    ParseEngine engine = ParseEngine::RecursiveDescent;
+    // With more than one thread, the elements of a top-level array are parsed in parallel
+    // by the recursive descent engine. 0 uses every hardware thread.
+    std::size_t threads = 1;
+    // The pool object keys are interned in, or none to copy every key into its object.
+    KeyPool *keys = nullptr;
+    // With a projection, only the values it keeps are parsed, by a dedicated scanner that
+    // ignores `engine` and `threads`.
+    const Projection *projection = nullptr;
+};
+
+struct SerializeOptions
+{
+    // Writes every character outside ASCII as a \uXXXX escape, so the output is pure ASCII.
+    bool escapeNonAscii = false;
+};
+
+/**
+ * @brief Serializes values into a buffer it keeps between calls, so once the buffer has
+ * grown to the size of the usual output, serializing doesn't allocate.
+ */
+class Writer
+{
+public:
+    explicit Writer(const SerializeOptions &options = SerializeOptions()) : options(options) {}
+
+    // Replaces the previous output with `json` serialized, and returns it.
+    std::string_view write(const JSON &json);
+    const std::string &output() const { return out; }
+
+private:
+    SerializeOptions options;
+    std::string out;
+};
+
+/**
+ * @brief Parses a value fed one chunk at a time, building it as the chunks arrive, so the
+ * whole input never has to be held in one buffer. See `PushReader` for the event version.
+ */
+class PushParser
+{
+public:
+    PushParser();
+    PushParser(const PushParser &) = delete;
+    PushParser &operator=(const PushParser &) = delete;
+    ~PushParser();
+
+    void feed(const char *data, std::size_t size);
+    void feed(std::string_view chunk);
+
+    // Ends the input and returns the value, the parser can then be fed the next one.
+    // Throws `SyntaxError` if the input is incomplete, which also resets the parser.
+    JSON finish();
+
+    // Drops the input fed so far, e.g. after `feed` has thrown.
+    void reset();
+
+private:
+    struct State;
+    std::unique_ptr<State> state;
+};
+
+struct JSONLinesOptions
+{
+    // The number of worker threads, 0 for one per hardware thread.
+    std::size_t threads = 0;
+    // The number of lines parsed by each task.
+    std::size_t batchSize = 256;
+    // The pool object keys are interned in, see `ParseOptions::keys`.
+    KeyPool *keys = nullptr;
+};
+
+// A line of newline-delimited JSON, `lineNumber` counts from 1.
+struct JSONLine
+{
+    std::size_t lineNumber;
+    JSON value;
+    // Empty if the line was parsed, otherwise why it wasn't.
+    std::string error;
+
+    bool ok() const { return error.empty(); }
+};
+
+// Unlike `serialize` and `Writer`, `toString` writes a top-level string without its
+// double-quotes, its escaped content only, e.g. `a\"b` for the string `a"b`. Nested strings
+// are quoted by both. Use `serialize` where the output must be JSON text.
+std::string toString(const JSON &json, const SerializeOptions &options = SerializeOptions());
+void serialize(const JSON &json, std::string &out, const SerializeOptions &options = SerializeOptions());
+JSON parse(std::string_view str);
+JSON parse(std::string_view str, const ParseOptions &options);
+JSON parse(const char *str, std::size_t size);
+JSON parseInSitu(char *str, std::size_t size);
+JSON parseFile(const std::string &path);
+void parseLines(std::string_view input, const std::function<void(JSONLine &line)> &callback, const JSONLinesOptions &options = JSONLinesOptions());
+std::vector<JSONLine> parseLines(std::string_view input, const JSONLinesOptions &options = JSONLinesOptions());
+void swap(JSON &first, JSON &second) noexcept;
+
+#endif
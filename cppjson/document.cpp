@@ -0,0 +1,51 @@
+#include <memory>
+#include <memory_resource>
+#include <string>
+
+#include "cppjson.hpp"
+#include "parser.hpp"
+
+/**
+ * @brief Construct an empty document.
+ *
+ * @param initialBlockSize the size of the first block of the arena, it is allocated once
+ * and kept across `reset()`. Inputs whose values don't fit in it make the arena grow.
+ */
+JSON::Document::Document(std::size_t initialBlockSize)
+    : initialBlock(new char[initialBlockSize]),
+      arena(initialBlock.get(), initialBlockSize),
+      _root(nullptr)
+{
+}
+
+JSON::Document::~Document() = default;
+
+/**
+ * @brief Parses `str` into the document, replacing what it held before.
+ *
+ * @param str
+ * @return const JSON& the root value
+ */
+const JSON &JSON::Document::parse(std::string_view str)
+{
+    reset();
+    Parser(str, buffer, &arena).parse(_root);
+    return _root;
+}
+
+const JSON &JSON::Document::root() const
+{
+    return _root;
+}
+
+/**
+ * @brief Frees every value of the document at once. The initial block and the decoding
+ * buffer are kept, so parsing the next input into the same document allocates nothing
+ * as long as it fits in them.
+ */
+void JSON::Document::reset()
+{
+    // The root and everything under it are borrowed from the arena, nothing is freed here.
+    _root = nullptr;
+    arena.release();
+}
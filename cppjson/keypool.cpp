@@ -0,0 +1,54 @@
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+
+#include "cppjson.hpp"
+
+KeyPool::KeyPool() = default;
+
+KeyPool::~KeyPool() = default;
+
+/**
+ * @brief Looks `key` up under a shared lock, so concurrent parses only serialize on the
+ * keys they add.
+ */
+std::string_view KeyPool::intern(std::string_view key)
+{
+    lookups.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto iter = keys.find(key);
+        if (iter != keys.end())
+        {
+            hits.fetch_add(1, std::memory_order_relaxed);
+            return *iter;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    // Another thread may have added it in the meantime.
+    auto iter = keys.find(key);
+    if (iter != keys.end())
+    {
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return *iter;
+    }
+
+    auto copy = static_cast<char *>(arena.allocate(key.size(), 1));
+    std::memcpy(copy, key.data(), key.size());
+    bytes += key.size();
+    return *keys.emplace(copy, key.size()).first;
+}
+
+KeyPool::Stats KeyPool::stats() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return Stats{lookups.load(std::memory_order_relaxed), hits.load(std::memory_order_relaxed), keys.size(), bytes};
+}
+
+KeyPool &KeyPool::global()
+{
+    static KeyPool pool;
+    return pool;
+}
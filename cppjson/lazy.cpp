@@ -0,0 +1,273 @@
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cppjson.hpp"
+#include "parser.hpp"
+#include "scan.hpp"
+#include "tape.hpp"
+
+using namespace cppjson::detail;
+
+/**
+ * @brief Indexes `input`, see `JSON::LazyDocument`.
+ */
+JSON::LazyDocument::LazyDocument(std::string_view input) : input(input)
+{
+    if (input.size() > UINT32_MAX)
+        throw std::length_error("A lazy document indexes inputs of up to 4 GiB");
+
+    buildStructuralIndex(input, positions);
+    matches.resize(positions.size());
+
+    std::vector<std::uint32_t> open;
+    for (std::uint32_t i = 0; i < positions.size(); i++)
+    {
+        auto ch = input[positions[i]];
+        if (ch == '{' || ch == '[')
+            open.push_back(i);
+        else if (ch == '}' || ch == ']')
+        {
+            if (open.empty() || input[positions[open.back()]] != (ch == '}' ? '{' : '['))
+                throw SyntaxError();
+            matches[open.back()] = i;
+            open.pop_back();
+        }
+    }
+
+    // Exactly one value.
+    if (positions.empty() || !open.empty() || root().next(0) != positions.size())
+        throw SyntaxError();
+}
+
+JSON::LazyDocument::~LazyDocument() = default;
+
+JSON::LazyValue JSON::LazyDocument::root() const
+{
+    return LazyValue(this, 0);
+}
+
+char JSON::LazyValue::first() const
+{
+    return document->input[document->positions[index]];
+}
+
+// Returns the index of the structural character right after the value at `value`.
+std::uint32_t JSON::LazyValue::next(std::uint32_t value) const
+{
+    auto ch = document->input[document->positions[value]];
+    if (ch == '{' || ch == '[')
+        return document->matches[value] + 1;
+    return value + 1;
+}
+
+// Throws `SyntaxError` unless `ch`, the structural character a value is expected at, can
+// start one, e.g. the value of "a" in `{"a":,"b":1}` would start at the comma.
+static void expectValue(char ch)
+{
+    if (ch == ':' || ch == ',' || ch == '}' || ch == ']')
+        throw SyntaxError();
+}
+
+JSON::Type JSON::LazyValue::type() const
+{
+    switch (first())
+    {
+    case '{':
+        return Object;
+    case '[':
+        return Array;
+    case '"':
+        return String;
+    case 't':
+    case 'f':
+        return Bool;
+    case 'n':
+        return Null;
+    default:
+        return Number;
+    }
+}
+
+bool JSON::LazyValue::isBoolean() const { return type() == Bool; }
+bool JSON::LazyValue::isNumber() const { return type() == Number; }
+bool JSON::LazyValue::isString() const { return type() == String; }
+bool JSON::LazyValue::isNull() const { return type() == Null; }
+bool JSON::LazyValue::isArray() const { return type() == Array; }
+bool JSON::LazyValue::isObject() const { return type() == Object; }
+
+// Looks for `key` among the members of the object, skipping the values of the others
+// without decoding them, and sets `value` to the index of its value.
+bool JSON::LazyValue::findMember(std::string_view key, std::uint32_t &value) const
+{
+    if (first() != '{')
+        throw std::logic_error("The type is not object");
+
+    auto &input = document->input;
+    auto &positions = document->positions;
+    auto end = document->matches[index];
+
+    auto i = index + 1;
+    while (i != end)
+    {
+        if (input[positions[i]] != '"' || i + 2 >= end || input[positions[i + 1]] != ':')
+            throw SyntaxError();
+        expectValue(input[positions[i + 2]]);
+
+        std::string_view name;
+        parseStringLiteral(input, positions[i], document->buffer, nullptr, name);
+        if (name == key)
+        {
+            value = i + 2;
+            return true;
+        }
+
+        i = next(i + 2);
+        if (input[positions[i]] == ',' && i + 1 != end)
+            i++;
+        else if (i != end)
+            throw SyntaxError();
+    }
+    return false;
+}
+
+JSON::LazyValue JSON::LazyValue::operator[](std::string_view key) const
+{
+    std::uint32_t value;
+    if (!findMember(key, value))
+        throw std::out_of_range("The key is not in the object");
+    return LazyValue(document, value);
+}
+
+bool JSON::LazyValue::contains(std::string_view key) const
+{
+    std::uint32_t value;
+    return findMember(key, value);
+}
+
+JSON::LazyValue JSON::LazyValue::operator[](std::size_t position) const
+{
+    if (first() != '[')
+        throw std::logic_error("The type is not array");
+
+    auto &input = document->input;
+    auto &positions = document->positions;
+    auto end = document->matches[index];
+
+    auto i = index + 1;
+    for (std::size_t count = 0; i != end; count++)
+    {
+        expectValue(input[positions[i]]);
+        if (count == position)
+            return LazyValue(document, i);
+
+        i = next(i);
+        if (input[positions[i]] == ',' && i + 1 != end)
+            i++;
+        else if (i != end)
+            throw SyntaxError();
+    }
+    throw std::out_of_range("The index is out of the array's range");
+}
+
+std::size_t JSON::LazyValue::size() const
+{
+    auto ch = first();
+    if (ch != '[' && ch != '{')
+        throw std::logic_error("Only JSON objects and arrays have a size");
+
+    auto &input = document->input;
+    auto &positions = document->positions;
+    auto end = document->matches[index];
+
+    std::size_t count = 0;
+    for (auto i = index + 1; i != end; count++)
+    {
+        // A member is a key, a colon and its value.
+        auto value = ch == '{' ? i + 2 : i;
+        if (value >= end)
+            throw SyntaxError();
+        expectValue(input[positions[value]]);
+        i = next(value);
+        if (i > end)
+            throw SyntaxError();
+        if (input[positions[i]] == ',' && i + 1 != end)
+            i++;
+        else if (i != end)
+            throw SyntaxError();
+    }
+    return count;
+}
+
+// Decodes a number, which must be followed by a whitespace, a structural character or the
+// end of the input.
+JSON JSON::LazyValue::number() const
+{
+    auto &input = document->input;
+    auto ch = first();
+    if (ch != '-' && (ch < '0' || ch > '9'))
+        throw std::logic_error("The type is not number");
+
+    JSON value(nullptr);
+    auto end = parseNumberLiteral(input, document->positions[index], value);
+    if (end != input.size() && !isWhitespace(input[end]) && !isStructuralOp(input[end]))
+        throw SyntaxError();
+    return value;
+}
+
+double JSON::LazyValue::getNumber() const { return number().getNumber(); }
+std::int64_t JSON::LazyValue::getInt64() const { return number().getInt64(); }
+std::uint64_t JSON::LazyValue::getUint64() const { return number().getUint64(); }
+
+bool JSON::LazyValue::getBool() const
+{
+    auto ch = first();
+    if (ch != 't' && ch != 'f')
+        throw std::logic_error("The type is not boolean");
+    return toJSON().getBool();
+}
+
+std::nullptr_t JSON::LazyValue::getNull() const
+{
+    if (first() != 'n')
+        throw std::logic_error("The value is not null");
+    return toJSON().getNull();
+}
+
+/**
+ * @brief Returns the content of the string. Without escape sequences it is a view into the
+ * input, otherwise it is decoded into the document the first time it is read, and later
+ * reads return the same string.
+ */
+std::string_view JSON::LazyValue::getString() const
+{
+    if (first() != '"')
+        throw std::logic_error("The type is not string");
+
+    auto cached = document->decoded.find(index);
+    if (cached != document->decoded.end())
+        return cached->second;
+
+    std::string_view value;
+    parseStringLiteral(document->input, document->positions[index], document->buffer, nullptr, value);
+    if (value.data() == document->buffer.data())
+        return document->decoded.emplace(index, value).first->second;
+    return value;
+}
+
+JSON JSON::LazyValue::toJSON() const
+{
+    auto &input = document->input;
+    auto &positions = document->positions;
+
+    auto begin = positions[index];
+    auto last = next(index);
+    // The value ends with its closing bracket, or before the next structural character.
+    std::size_t end = first() == '{' || first() == '[' ? positions[last - 1] + 1
+                      : last < positions.size()      ? positions[last]
+                                                     : input.size();
+    return parse(input.substr(begin, end - begin));
+}
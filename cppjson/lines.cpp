@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "cppjson.hpp"
+#include "parser.hpp"
+#include "threadpool.hpp"
+
+using namespace cppjson::detail;
+
+namespace
+{
+    // A run of consecutive lines, parsed by one task.
+    struct Batch
+    {
+        std::string_view text;
+        std::size_t firstLine;
+        std::vector<JSONLine> lines;
+        bool done = false;
+    };
+
+    void parseBatch(Batch &batch, KeyPool *keys)
+    {
+        auto text = batch.text;
+        auto lineNumber = batch.firstLine;
+
+        while (!text.empty())
+        {
+            auto end = std::min(text.find('\n'), text.size());
+            auto line = text.substr(0, end);
+            text.remove_prefix(std::min(end + 1, text.size()));
+
+            // Blank lines separate nothing and are skipped.
+            if (skipWhitespaces(line, 0) != line.size())
+            {
+                JSONLine result{lineNumber, JSON(nullptr), std::string()};
+                try
+                {
+                    result.value = keys ? parse(line, ParseOptions{ParseEngine::RecursiveDescent, 1, keys}) : parse(line);
+                }
+                catch (const SyntaxError &)
+                {
+                    result.error = "JSON syntax error";
+                }
+                catch (const std::exception &e)
+                {
+                    result.error = e.what();
+                }
+                batch.lines.push_back(std::move(result));
+            }
+            lineNumber++;
+        }
+    }
+}
+
+/**
+ * @brief Parses newline-delimited JSON, one value per line, on a work-stealing thread pool.
+ *
+ * The input is cut into batches of `options.batchSize` lines, and every batch is parsed by
+ * one task. `callback` is called on the calling thread for every non-blank line, in the
+ * order of the input, as soon as its batch is done. A line that fails to parse is reported
+ * with its error instead of stopping the others. At most a few batches per thread are in
+ * flight, so the results of the whole input are never held at once.
+ */
+void parseLines(std::string_view input, const std::function<void(JSONLine &line)> &callback, const JSONLinesOptions &options)
+{
+    auto threads = options.threads ? options.threads : ThreadPool::defaultSize();
+    auto batchSize = std::max<std::size_t>(options.batchSize, 1);
+    auto maxInFlight = 4 * threads;
+
+    std::mutex mutex;
+    std::condition_variable batchDone;
+    // A deque keeps the batches in place while others are added or removed.
+    std::deque<Batch> inFlight;
+    // Destroyed first, which waits for the tasks referring to the batches.
+    ThreadPool pool(threads);
+
+    auto deliverFirst = [&]()
+    {
+        auto &batch = inFlight.front();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            batchDone.wait(lock, [&batch]()
+                           { return batch.done; });
+        }
+        for (auto &line : batch.lines)
+            callback(line);
+        inFlight.pop_front();
+    };
+
+    std::size_t offset = 0;
+    std::size_t lineNumber = 1;
+    while (offset < input.size())
+    {
+        auto begin = offset;
+        std::size_t count = 0;
+        while (offset < input.size() && count < batchSize)
+        {
+            auto newline = static_cast<const char *>(std::memchr(input.data() + offset, '\n', input.size() - offset));
+            offset = newline ? newline - input.data() + 1 : input.size();
+            count++;
+        }
+
+        inFlight.push_back(Batch{input.substr(begin, offset - begin), lineNumber, {}});
+        lineNumber += count;
+
+        auto &batch = inFlight.back();
+        auto keys = options.keys;
+        pool.submit([&batch, &mutex, &batchDone, keys]()
+                    {
+                        parseBatch(batch, keys);
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            batch.done = true;
+                        }
+                        batchDone.notify_all(); });
+
+        if (inFlight.size() >= maxInFlight)
+            deliverFirst();
+    }
+
+    while (!inFlight.empty())
+        deliverFirst();
+}
+
+std::vector<JSONLine> parseLines(std::string_view input, const JSONLinesOptions &options)
+{
+    std::vector<JSONLine> lines;
+    parseLines(
+        input, [&lines](JSONLine &line)
+        { lines.push_back(std::move(line)); },
+        options);
+    return lines;
+}
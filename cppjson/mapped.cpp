@@ -0,0 +1,131 @@
+#include <cerrno>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include "cppjson.hpp"
+#include "parser.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CPP_JSON_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+/**
+ * @brief The content of a file, mapped read-only into memory. Where `mmap` isn't available
+ * the file is read into a buffer instead.
+ */
+class FileMapping
+{
+public:
+    const char *data = nullptr;
+    std::size_t size = 0;
+
+    explicit FileMapping(const std::string &path)
+    {
+#ifdef CPP_JSON_MMAP
+        auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "cannot open " + path);
+
+        struct stat status;
+        if (::fstat(fd, &status) < 0)
+        {
+            auto error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "cannot stat " + path);
+        }
+
+        size = static_cast<std::size_t>(status.st_size);
+        // An empty file can't be mapped, there is nothing to map anyway.
+        if (size != 0)
+        {
+            auto address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED)
+            {
+                auto error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "cannot map " + path);
+            }
+            // The parser reads the file once from the beginning to the end.
+            ::madvise(address, size, MADV_SEQUENTIAL);
+            data = static_cast<const char *>(address);
+        }
+        ::close(fd);
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+            throw std::system_error(std::make_error_code(std::errc::no_such_file_or_directory), "cannot open " + path);
+        size = static_cast<std::size_t>(file.tellg());
+        copy.reset(new char[size]);
+        file.seekg(0);
+        file.read(copy.get(), size);
+        data = copy.get();
+#endif
+    }
+
+    FileMapping(const FileMapping &) = delete;
+    FileMapping &operator=(const FileMapping &) = delete;
+
+    ~FileMapping()
+    {
+#ifdef CPP_JSON_MMAP
+        if (data)
+            ::munmap(const_cast<char *>(data), size);
+#endif
+    }
+
+    std::string_view bytes() const
+    {
+        return std::string_view(data ? data : "", size);
+    }
+
+#ifndef CPP_JSON_MMAP
+    std::unique_ptr<char[]> copy;
+#endif
+};
+
+struct JSON::MappedDocument::Mapping : FileMapping
+{
+    using FileMapping::FileMapping;
+};
+
+JSON::MappedDocument::MappedDocument(const std::string &path)
+    : mapping(new Mapping(path)), _root(nullptr)
+{
+    Parser(mapping->bytes(), buffer, &arena, nullptr, true).parse(_root);
+}
+
+JSON::MappedDocument::~MappedDocument()
+{
+    // The tree lives in the arena and borrows from the mapping, nothing is freed node by
+    // node. The arena is released before the mapping is unmapped.
+    _root = nullptr;
+}
+
+const JSON &JSON::MappedDocument::root() const
+{
+    return _root;
+}
+
+std::string_view JSON::MappedDocument::bytes() const
+{
+    return mapping->bytes();
+}
+
+/**
+ * @brief Parses the file at `path` straight from a read-only mapping of it, without reading
+ * it into a string first. The result owns all of its values, see `JSON::MappedDocument` to
+ * keep the strings as views into the file instead.
+ */
+JSON parseFile(const std::string &path)
+{
+    FileMapping mapping(path);
+    return parse(mapping.bytes());
+}
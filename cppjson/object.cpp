@@ -0,0 +1,226 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#include "cppjson.hpp"
+
+std::uint64_t JSON::ObjectMap::hash(std::string_view key)
+{
+    return std::hash<std::string_view>()(key);
+}
+
+static std::uint64_t hashTag(std::uint64_t hash)
+{
+    return hash >> 32;
+}
+
+// Interned keys are equal when their addresses are, so most hits skip the bytes.
+static bool sameKey(std::string_view key, std::string_view other)
+{
+    return key.size() == other.size() && (key.data() == other.data() || std::memcmp(key.data(), other.data(), key.size()) == 0);
+}
+
+JSON::Key::Key(std::string_view key, std::pmr::memory_resource *arena) : value(nullptr)
+{
+    value.makeString(key, arena);
+}
+
+JSON::Key::Key(std::string_view key, KeyPool &pool) : value(nullptr)
+{
+    if (key.size() <= ShortStringCapacity)
+    {
+        value.makeString(key, nullptr);
+        return;
+    }
+
+    value.borrowString(pool.intern(key));
+    if (value._kind == Borrowed)
+        value._kind = Interned;
+}
+
+JSON::ObjectMap &JSON::ObjectMap::operator=(const ObjectMap &rhs)
+{
+    if (this == &rhs)
+        return *this;
+
+    // The keys are copied into this object's own storage.
+    entries.clear();
+    entries.reserve(rhs.size());
+    for (auto &member : rhs)
+        entries.emplace_back(member.first.isInterned() ? member.first : Key(member.first, arena), member.second);
+    index = rhs.index;
+    return *this;
+}
+
+void JSON::ObjectMap::clear()
+{
+    entries.clear();
+    index.clear();
+}
+
+/**
+ * @brief Returns the position of the member named `key`, or `size()` if there is none.
+ * With the index, `hash` is set to the key's hash for `indexEntry()`.
+ */
+std::size_t JSON::ObjectMap::findPosition(std::string_view key, std::uint64_t &hash) const
+{
+    if (index.empty())
+    {
+        for (std::size_t i = 0; i < entries.size(); i++)
+            if (sameKey(entries[i].first, key))
+                return i;
+        return entries.size();
+    }
+
+    hash = ObjectMap::hash(key);
+    return probe(key, hash);
+}
+
+// Looks `key` up in the index.
+std::size_t JSON::ObjectMap::probe(std::string_view key, std::uint64_t hash) const
+{
+    auto mask = index.size() - 1;
+    for (auto slot = hash & mask;; slot = (slot + 1) & mask)
+    {
+        auto entry = index[slot];
+        if (entry == 0)
+            return entries.size();
+
+        auto position = static_cast<std::uint32_t>(entry) - 1;
+        if ((entry >> 32) == hashTag(hash) && sameKey(entries[position].first, key))
+            return position;
+    }
+}
+
+void JSON::ObjectMap::indexEntry(std::size_t position, std::uint64_t hash)
+{
+    auto mask = index.size() - 1;
+    auto slot = hash & mask;
+    while (index[slot] != 0)
+        slot = (slot + 1) & mask;
+    index[slot] = (hashTag(hash) << 32) | (position + 1);
+}
+
+/**
+ * @brief Rebuilds the index for the current entries, at most half full, or drops it if
+ * the object is small enough to be scanned.
+ */
+void JSON::ObjectMap::rebuildIndex()
+{
+    index.clear();
+    if (entries.size() <= IndexThreshold)
+        return;
+
+    std::size_t slots = 32;
+    while (slots < 2 * entries.size())
+        slots *= 2;
+    index.assign(slots, 0);
+
+    for (std::size_t i = 0; i < entries.size(); i++)
+        indexEntry(i, hash(entries[i].first));
+}
+
+std::pair<JSON::ObjectMap::iterator, bool> JSON::ObjectMap::insert(std::string_view key, JSON &&value)
+{
+    std::uint64_t hash = 0;
+    auto position = findPosition(key, hash);
+    if (position != entries.size())
+        return {entries.begin() + position, false};
+    return {append(Key(key, arena), std::move(value), hash), true};
+}
+
+std::pair<JSON::ObjectMap::iterator, bool> JSON::ObjectMap::insert(Key &&key, JSON &&value)
+{
+    std::uint64_t hash = 0;
+    auto position = findPosition(key, hash);
+    if (position != entries.size())
+        return {entries.begin() + position, false};
+    return {append(std::move(key), std::move(value), hash), true};
+}
+
+// Adds a member whose key isn't there yet, `hash` is the one `findPosition()` computed.
+JSON::ObjectMap::iterator JSON::ObjectMap::append(Key &&key, JSON &&value, std::uint64_t hash)
+{
+    // Most objects are small, start with room for a few members.
+    if (entries.capacity() == 0)
+        entries.reserve(4);
+    entries.emplace_back(std::move(key), std::move(value));
+
+    auto position = entries.size() - 1;
+    if (2 * entries.size() > index.size())
+        rebuildIndex();
+    else
+        indexEntry(position, hash);
+    return entries.begin() + position;
+}
+
+JSON::ObjectMap::iterator JSON::ObjectMap::find(std::string_view key)
+{
+    std::uint64_t hash;
+    return entries.begin() + findPosition(key, hash);
+}
+
+JSON::ObjectMap::const_iterator JSON::ObjectMap::find(std::string_view key) const
+{
+    std::uint64_t hash;
+    return entries.begin() + findPosition(key, hash);
+}
+
+JSON::ObjectMap::iterator JSON::ObjectMap::find(std::string_view key, std::uint64_t hash)
+{
+    return entries.begin() + (index.empty() ? findPosition(key, hash) : probe(key, hash));
+}
+
+JSON::ObjectMap::const_iterator JSON::ObjectMap::find(std::string_view key, std::uint64_t hash) const
+{
+    return entries.begin() + (index.empty() ? findPosition(key, hash) : probe(key, hash));
+}
+
+JSON::ObjectMap::size_type JSON::ObjectMap::count(std::string_view key) const
+{
+    return contains(key) ? 1 : 0;
+}
+
+bool JSON::ObjectMap::contains(std::string_view key) const
+{
+    return find(key) != end();
+}
+
+JSON &JSON::ObjectMap::at(std::string_view key)
+{
+    auto iter = find(key);
+    if (iter == end())
+        throw std::out_of_range("The key is not in the object");
+    return iter->second;
+}
+
+const JSON &JSON::ObjectMap::at(std::string_view key) const
+{
+    return const_cast<ObjectMap &>(*this).at(key);
+}
+
+JSON &JSON::ObjectMap::operator[](std::string_view key)
+{
+    return insert(key, JSON()).first->second;
+}
+
+JSON::ObjectMap::iterator JSON::ObjectMap::erase(const_iterator position)
+{
+    auto next = entries.erase(position);
+    if (!index.empty())
+        rebuildIndex();
+    return next;
+}
+
+JSON::ObjectMap::size_type JSON::ObjectMap::erase(std::string_view key)
+{
+    auto iter = find(key);
+    if (iter == end())
+        return 0;
+    erase(iter);
+    return 1;
+}
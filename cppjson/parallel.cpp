@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cppjson.hpp"
+#include "parser.hpp"
+#include "projection.hpp"
+#include "tape.hpp"
+#include "threadpool.hpp"
+
+using namespace cppjson::detail;
+
+/**
+ * @brief Finds the commas separating the elements of the top-level array opening at
+ * `open`, skipping strings and nested values, and appends their positions to `separators`
+ * followed by the position of the closing bracket.
+ *
+ * The input is classified 64 bytes at a time like the tape engine does, so only the
+ * structural characters outside strings are looked at one by one. Returns false if the
+ * array isn't closed or a bracket closes a container of the other kind.
+ */
+static bool findElementSeparators(std::string_view input, std::size_t open, std::vector<std::size_t> &separators)
+{
+    StringTracker strings;
+    // The closing bracket every open container expects, innermost last.
+    std::string closers;
+
+    for (std::size_t offset = open & ~std::size_t(63); offset < input.size(); offset += 64)
+    {
+        BlockMasks masks;
+        classifyBlock(input, offset, masks);
+        auto ops = masks.op & ~strings.next(masks);
+
+        // The bytes before the opening bracket have been checked to be whitespaces.
+        if (offset < open)
+            ops &= ~std::uint64_t(0) << (open - offset);
+
+        while (ops)
+        {
+            auto index = offset + __builtin_ctzll(ops);
+            ops &= ops - 1;
+
+            auto ch = input[index];
+            if (ch == '[')
+                closers.push_back(']');
+            else if (ch == '{')
+                closers.push_back('}');
+            else if (ch == ']' || ch == '}')
+            {
+                if (ch != closers.back())
+                    return false;
+                closers.pop_back();
+                if (closers.empty())
+                {
+                    separators.push_back(index);
+                    return true;
+                }
+            }
+            else if (ch == ',' && closers.size() == 1)
+                separators.push_back(index);
+        }
+    }
+    return false;
+}
+
+static JSON parseSerial(std::string_view input, KeyPool *keys)
+{
+    JSON result(nullptr);
+    std::string buffer;
+    Parser(input, buffer, nullptr, nullptr, false, keys).parse(result);
+    return result;
+}
+
+/**
+ * @brief Parses an input whose top-level value is an array with its elements split across
+ * `threads` threads.
+ *
+ * A first pass finds the boundaries of the elements, then the elements are handed out to a
+ * thread pool in runs of about the same size, and every run is parsed straight into its
+ * slots of the result array, so nothing is joined or copied afterwards. Any other input,
+ * and any input with an error, goes through the serial parser, which reports the error.
+ */
+JSON parseParallel(std::string_view input, std::size_t threads, KeyPool *keys)
+{
+    auto open = skipWhitespaces(input, 0);
+    if (threads <= 1 || open == input.size() || input[open] != '[')
+        return parseSerial(input, keys);
+
+    std::vector<std::size_t> separators;
+    if (!findElementSeparators(input, open, separators) || skipWhitespaces(input, separators.back() + 1) != input.size())
+        return parseSerial(input, keys);
+
+    // An empty array has no element, not an empty one.
+    if (separators.size() == 1 && skipWhitespaces(input, open + 1) == separators.back())
+        return JSON::array();
+
+    auto result = JSON::array(separators.size());
+    auto &items = result.items();
+
+    auto elementBegin = [&](std::size_t i)
+    { return i == 0 ? open + 1 : separators[i - 1] + 1; };
+
+    // About eight runs per thread, so the ones that parse faster can steal the others.
+    auto runSize = std::max<std::size_t>(input.size() / (threads * 8), 1);
+
+    std::mutex mutex;
+    std::condition_variable runDone;
+    std::size_t pending = 0;
+    std::exception_ptr error;
+
+    {
+        ThreadPool pool(threads);
+        for (std::size_t first = 0; first < items.size();)
+        {
+            auto last = first + 1;
+            while (last < items.size() && separators[last - 1] - elementBegin(first) < runSize)
+                last++;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending++;
+            }
+            pool.submit([&, first, last]()
+                        {
+                            try
+                            {
+                                std::string buffer;
+                                for (auto i = first; i < last; i++)
+                                {
+                                    auto begin = elementBegin(i);
+                                    Parser(input.substr(begin, separators[i] - begin), buffer, nullptr, nullptr, false, keys).parse(items[i]);
+                                }
+                            }
+                            catch (...)
+                            {
+                                std::lock_guard<std::mutex> lock(mutex);
+                                if (!error)
+                                    error = std::current_exception();
+                            }
+
+                            std::lock_guard<std::mutex> lock(mutex);
+                            if (--pending == 0)
+                                runDone.notify_all(); });
+            first = last;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        runDone.wait(lock, [&]()
+                     { return pending == 0; });
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+    return result;
+}
+
+JSON parse(std::string_view str, const ParseOptions &options)
+{
+    if (options.projection)
+        return parseProjected(str, *options.projection, options.keys);
+    if (options.engine == ParseEngine::Tape)
+    {
+        Tape tape;
+        tape.parse(str);
+        return tape.toJSON(options.keys);
+    }
+    if (options.threads != 1)
+        return parseParallel(str, options.threads ? options.threads : ThreadPool::defaultSize(), options.keys);
+    return parseSerial(str, options.keys);
+}
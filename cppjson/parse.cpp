@@ -1,294 +1,276 @@
+#include <algorithm>
 #include <array>
 #include <cctype>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <cstdlib>
 #include <cmath>
-#include <sstream>
+#include <new>
 #include <cstring>
 #include <limits>
-#include <cerrno>
 
 #include "cppjson.hpp"
+#include "parser.hpp"
+#include "scan.hpp"
 
 using std::isdigit;
 using std::logic_error;
 using std::pair;
-using std::string;
-
-pair<JSON, string::size_type> parseJSON(const string &input, string::size_type index);
-pair<JSON, string::size_type> parseJSONObject(const string &input, string::size_type index);
-pair<JSON, string::size_type> parseJSONArray(const string &input, string::size_type index);
-pair<std::string, string::size_type> parseStringLiteral(const string &input, string::size_type index);
-pair<JSON, string::size_type> parseJSONNumber(const string &input, string::size_type index);
-string::size_type expectString(const string &input, string::size_type index, const string &keyword);
-string::size_type skipWhitespaces(const string &input, string::size_type index);
-inline bool isHexLiteral(const string &input, string::size_type index);
-inline bool isOctalLiteral(const string &input, string::size_type index);
-std::pair<char16_t, string::size_type> parseUTF16EscapedValue(const string &input, string::size_type index);
+using namespace cppjson::detail;
+
+std::size_t decodeEscapes(std::string_view raw, char *out);
+std::pair<char16_t, size_type> parseUTF16EscapedValue(std::string_view input, size_type index);
 inline bool isLeadSurrogate(char16_t v);
 inline bool isTrailSurrogate(char16_t v);
 char32_t calculateCodepoint(char16_t leadSurroatge, char16_t trailSurrogate);
-void writeAsUTF8CodeUnits(std::ostringstream &oss, char32_t codepoint);
-void writeHexValueToBuffer(char buf[], const string &input, string::size_type index);
+std::size_t writeAsUTF8CodeUnits(char *out, char32_t codepoint);
+void writeHexValueToBuffer(char buf[], std::string_view input, size_type index);
 
-JSON parse(const string &str)
+JSON parse(std::string_view str)
 {
-    auto result = parseJSON(str, 0);
-    auto end = skipWhitespaces(str, result.second);
-    if (end != str.size())
-        throw SyntaxError();
-    return result.first;
+    JSON result(nullptr);
+    std::string buffer;
+    Parser(str, buffer).parse(result);
+    return result;
 }
 
-pair<JSON, string::size_type> parseJSON(const string &input, string::size_type index)
+JSON parse(const char *str, std::size_t size)
 {
-    index = skipWhitespaces(input, index);
-    auto ch = input[index];
-    if (ch == '{')
-        return parseJSONObject(input, index);
-    else if (ch == '[')
-        return parseJSONArray(input, index);
-    else if (ch == '"')
-    {
-        auto result = parseStringLiteral(input, index);
-        return std::make_pair(JSON(result.first), result.second);
-    }
-    else if (isdigit(ch) || ch == '-')
-        return parseJSONNumber(input, index);
-    else if (ch == 't')
-    {
-        index = expectString(input, index, "true");
-        return std::make_pair(JSON(true), index);
-    }
-    else if (ch == 'f')
-    {
-        index = expectString(input, index, "false");
-        return std::make_pair(JSON(false), index);
-    }
-    else if (ch == 'n')
-    {
-        index = expectString(input, index, "null");
-        return std::make_pair(JSON(nullptr), index);
-    }
-    else
-        throw SyntaxError();
+    return parse(std::string_view(str, size));
 }
 
-// The program looked ahead the next character first, and confirmed the what
-// JSON value would be next, before it actually calls the function to parse a
-// value, so the initial `index` value must points to the first character of
-// a JSON value, hence we can simply skip it without checking.
+/**
+ * @brief Parses the `size` bytes at `str` in place.
+ *
+ * Escape sequences are decoded inside the buffer and string values are views into it, so
+ * strings cost no allocation at all. The buffer is modified and must outlive the result
+ * (copies of the result own their strings). Object keys are still copied into the object.
+ */
+JSON parseInSitu(char *str, std::size_t size)
+{
+    JSON result(nullptr);
+    std::string buffer;
+    Parser(std::string_view(str, size), buffer, nullptr, str).parse(result);
+    return result;
+}
 
-pair<JSON, string::size_type> parseJSONObject(const string &input, string::size_type index)
+void Parser::parse(JSON &out)
 {
-    std::map<std::string, JSON> result;
-    index = skipWhitespaces(input, index + 1);
+    start(out);
+    SaxReader<Parser>(input, *this, buffer, inSitu).parse();
+}
 
-    if (index == input.size())
-        throw SyntaxError();
-    if (input[index] == '}')
-        return std::make_pair(JSON(result), index + 1);
+// Returns the slot the next value is built into, which is the root, a new element of the
+// array being parsed or the member `onKey` has added.
+JSON *Parser::slot()
+{
+    if (stack.empty())
+        return root;
 
-    while (true)
-    {
-        index = skipWhitespaces(input, index);
-        auto objectKey = parseStringLiteral(input, index);
-        index = skipWhitespaces(input, objectKey.second);
-        index = expectString(input, index, ":");
-        index = skipWhitespaces(input, index);
-        auto objectValue = parseJSON(input, index);
-        index = skipWhitespaces(input, objectValue.second);
-
-        if (input[index] == '}')
-        {
-            result[objectKey.first] = objectValue.first;
-            return std::make_pair(JSON(result), index + 1);
-        }
-        else if (input[index] == ',')
-        {
-            result[objectKey.first] = objectValue.first;
-            index++;
-        }
-        else
-            throw SyntaxError();
-    }
+    auto container = stack.back();
+    if (container->isObject())
+        return member;
 
-    throw SyntaxError();
+    auto &items = container->items();
+    items.emplace_back(nullptr);
+    return &items.back();
 }
 
-pair<JSON, string::size_type> parseJSONArray(const string &input, string::size_type index)
+void Parser::onString(std::string_view value)
 {
-    std::vector<JSON> result;
-    index = skipWhitespaces(input, index + 1);
+    auto out = slot();
+    if (inSitu || (borrowInput && value.data() >= input.data() && value.data() < input.data() + input.size()))
+        out->borrowString(value);
+    else
+        out->makeString(value, arena);
+}
 
-    if (index == input.size())
-        throw SyntaxError();
-    if (input[index] == ']')
-        return std::make_pair(JSON(result), index + 1);
+void Parser::onKey(std::string_view key)
+{
+    // A duplicated key keeps its first slot, the value parsed later replaces it.
+    auto &members = stack.back()->members();
+    if (keys)
+        member = &members.emplace(JSON::Key(key, *keys), nullptr).first->second;
+    else
+        member = &members.emplace(key, nullptr).first->second;
+}
+
+void Parser::onStartObject()
+{
+    auto out = slot();
+    out->makeObject(arena, inSitu || borrowInput);
+    stack.push_back(out);
+}
+
+void Parser::onStartArray()
+{
+    auto out = slot();
+    out->makeArray(arena, inSitu || borrowInput);
+    stack.push_back(out);
+}
+
+// Parses the string literal starting at `index`, points `value` at its content and returns
+// the index right after its closing double-quote. It is shared by every parsing engine.
+//
+// The literal is first scanned for its end. Without escape sequences, which is the common
+// case, `value` is a view into the input and nothing is copied. Otherwise the content is
+// decoded into `buffer`, or over the literal itself in in-situ mode: a decoded sequence is
+// never longer than its escaped form, so the decoding never overtakes what it reads.
+size_type cppjson::detail::parseStringLiteral(std::string_view input, size_type index, std::string &buffer, char *inSitu, std::string_view &value)
+{
+    // Skip the double-quote at the begining
+    auto start = ++index;
+    auto escaped = false;
+
+    auto findStringSpecial = scanKernels().findStringSpecial;
 
     while (true)
     {
-        auto jsonVal = parseJSON(input, index);
-        index = skipWhitespaces(input, jsonVal.second);
-
-        if (index == input.size())
+        index = findStringSpecial(input.data(), input.size(), index);
+        if (index >= input.size())
             throw SyntaxError();
-        else if (input[index] == ']')
+
+        if (input[index] == '"')
+            break;
+        else if (input[index] == '\\')
         {
-            result.push_back(jsonVal.first);
-            return std::make_pair(JSON(result), index + 1);
+            // A backslash needs the character it escapes, and the closing double-quote.
+            if (index + 1 >= input.size())
+                throw SyntaxError();
+            escaped = true;
+            index += 2;
         }
-        else if (input[index] == ',')
+        else
+            // Control characters must be escaped in JSON strings.
+            throw SyntaxError();
+    }
+
+    auto raw = input.substr(start, index - start);
+    if (!escaped)
+    {
+        value = raw;
+    }
+    else
+    {
+        char *out;
+        if (inSitu)
         {
-            result.push_back(jsonVal.first);
-            index = skipWhitespaces(input, index + 1);
+            out = inSitu + start;
         }
         else
-            throw SyntaxError();
+        {
+            buffer.resize(raw.size());
+            out = &buffer[0];
+        }
+        value = std::string_view(out, decodeEscapes(raw, out));
     }
+
+    return index + 1;
 }
 
-pair<std::string, string::size_type> parseStringLiteral(const string &input, string::size_type index)
+// Decodes the escape sequences in `raw`, the content of a string literal without its
+// double-quotes, writes the result to `out` and returns its length. `out` may be
+// `raw.data()` itself.
+std::size_t decodeEscapes(std::string_view raw, char *out)
 {
-    // Skip the double-quote at the begining
-    index++;
-
-    string::size_type start = index;
-    std::ostringstream oss;
+    size_type index = 0;
+    size_type start = 0;
+    std::size_t length = 0;
 
-    while (index != input.size())
+    while (index != raw.size())
     {
-        if (input[index] == '\\')
+        if (raw[index] != '\\')
         {
-            if (index + 1 >= input.size())
-                throw SyntaxError();
+            index++;
+            continue;
+        }
+
+        if (index + 1 >= raw.size())
+            throw SyntaxError();
 
-            oss << input.substr(start, index - start);
+        std::memmove(out + length, raw.data() + start, index - start);
+        length += index - start;
 
-            auto ch = input[index + 1];
-            if (ch == 'u')
+        auto ch = raw[index + 1];
+        if (ch == 'u')
+        {
+            auto v1 = parseUTF16EscapedValue(raw, index);
+            if (isLeadSurrogate(v1.first))
             {
-                auto v1 = parseUTF16EscapedValue(input, index);
-                if (isLeadSurrogate(v1.first))
-                {
-                    // If the escaped value we just read is a lead surrogate, there must be a trail surrogate right after it.
-                    // Together they indicate a single Unicode character.
-                    //
-                    // Since the value we have just parsed is a lead surrogate, we need to get its correspondent trail surrogate.
+                // If the escaped value we just read is a lead surrogate, there must be a trail surrogate right after it.
+                // Together they indicate a single Unicode character.
+                //
+                // Since the value we have just parsed is a lead surrogate, we need to get its correspondent trail surrogate.
 
-                    if (v1.second + 1 < input.size() && input[v1.second] == '\\' && input[v1.second + 1] == 'u')
+                if (v1.second + 1 < raw.size() && raw[v1.second] == '\\' && raw[v1.second + 1] == 'u')
+                {
+                    auto v2 = parseUTF16EscapedValue(raw, v1.second);
+                    if (isTrailSurrogate(v2.first))
                     {
-                        auto v2 = parseUTF16EscapedValue(input, v1.second);
-                        if (isTrailSurrogate(v2.first))
-                        {
-                            auto leadSurrogate = v1.first;
-                            auto trailSurrogate = v2.first;
-                            auto codePoint = calculateCodepoint(leadSurrogate, trailSurrogate);
-                            writeAsUTF8CodeUnits(oss, codePoint);
-                        }
-                        else
-                        {
-                            // The trail surrogate isn't valid because it's value is out of range (which should be between 0xDC00 to 0xDFFF).
-                            // In such case, two values are treated as two codepoints individually and will be written to the output together.
-                            writeAsUTF8CodeUnits(oss, v1.first);
-                            writeAsUTF8CodeUnits(oss, v2.first);
-                        }
-                        index = v2.second;
+                        auto leadSurrogate = v1.first;
+                        auto trailSurrogate = v2.first;
+                        auto codePoint = calculateCodepoint(leadSurrogate, trailSurrogate);
+                        length += writeAsUTF8CodeUnits(out + length, codePoint);
                     }
                     else
                     {
-                        // There are no another UTF-16 escaped value after the lead surrogate, which is invalid. The program will write the
-                        // lead surrogate to the output then continue.
-                        writeAsUTF8CodeUnits(oss, v1.first);
-                        index = v1.second;
+                        // The trail surrogate isn't valid because it's value is out of range (which should be between 0xDC00 to 0xDFFF).
+                        // In such case, two values are treated as two codepoints individually and will be written to the output together.
+                        length += writeAsUTF8CodeUnits(out + length, v1.first);
+                        length += writeAsUTF8CodeUnits(out + length, v2.first);
                     }
+                    index = v2.second;
                 }
                 else
                 {
-                    // If the first escaped value isn't a lead surrogate, we will regard it as an Unicode codepoint and will write it to the
-                    // output (It might be a trail surrogate but we need not to distinguish it).
-                    writeAsUTF8CodeUnits(oss, v1.first);
+                    // There are no another UTF-16 escaped value after the lead surrogate, which is invalid. The program will write the
+                    // lead surrogate to the output then continue.
+                    length += writeAsUTF8CodeUnits(out + length, v1.first);
                     index = v1.second;
                 }
             }
             else
             {
-                if (ch == '\\')
-                    oss << '\\';
-                else if (ch == '/')
-                    oss << '/';
-                else if (ch == 'b')
-                    oss << '\b';
-                else if (ch == 'f')
-                    oss << '\f';
-                else if (ch == 'n')
-                    oss << '\n';
-                else if (ch == 'r')
-                    oss << '\r';
-                else if (ch == 't')
-                    oss << '\t';
-                else
-                    throw SyntaxError();
-
-                index += 2;
-            }
-
-            start = index;
-        }
-        else if (input[index] == '"')
-        {
-            if (start < index)
-            {
-                oss << input.substr(start, index - start);
+                // If the first escaped value isn't a lead surrogate, we will regard it as an Unicode codepoint and will write it to the
+                // output (It might be a trail surrogate but we need not to distinguish it).
+                length += writeAsUTF8CodeUnits(out + length, v1.first);
+                index = v1.second;
             }
-            return std::make_pair(oss.str(), index + 1);
         }
         else
         {
-            index++;
-        }
-    }
-
-    throw SyntaxError();
-}
-
-pair<JSON, string::size_type> parseJSONNumber(const string &input, string::size_type index)
-{
-    // correspondent regex:
-    // /^-?(0|([1-9][0-9]*))(\.[0-9]+)?((e|E)(-|\+)?[0-9]+)?$/
-
-    // We could parse a number with our own codes, but for now we will just use `std::strtod`
-    // instead.
-
-    // JSON doesn't supports hex literals and octal literals, but `strtod` can parse them,
-    // so we should exclude them before parsing.
-    // Hex literal is something like 0x3, 0XE2, a literal started with 0x or 0X, and Octal
-    // literals is somthing like 045, 022, a literal started with a leading zero.
-    //
-    // In JSON, if a number's interal part's first digit is zero, it must be followed by the
-    // decimal point (.), no other digits can be appeared behind it.
-    if (isHexLiteral(input, index) || isOctalLiteral(input, index))
-        throw SyntaxError();
-
-    const char *cStr = input.c_str();
-    char *endPtr = const_cast<char *>(cStr);
+            if (ch == '"')
+                out[length++] = '"';
+            else if (ch == '\\')
+                out[length++] = '\\';
+            else if (ch == '/')
+                out[length++] = '/';
+            else if (ch == 'b')
+                out[length++] = '\b';
+            else if (ch == 'f')
+                out[length++] = '\f';
+            else if (ch == 'n')
+                out[length++] = '\n';
+            else if (ch == 'r')
+                out[length++] = '\r';
+            else if (ch == 't')
+                out[length++] = '\t';
+            else
+                throw SyntaxError();
 
-    double result = std::strtod(cStr + index, &endPtr);
+            index += 2;
+        }
 
-    if (endPtr == cStr)
-        throw SyntaxError();
-    else if (result == HUGE_VAL)
-        result = std::numeric_limits<double>::infinity();
-    else if (errno == ERANGE)
-        // Underflow, like 1.0E-1000
-        result = result > 0 ? 0 : -0;
+        start = index;
+    }
 
-    return std::make_pair(JSON(result), endPtr - cStr);
+    std::memmove(out + length, raw.data() + start, index - start);
+    return length + (index - start);
 }
 
-string::size_type expectString(const string &input, string::size_type index, const string &str)
+size_type cppjson::detail::expectString(std::string_view input, size_type index, std::string_view str)
 {
     auto i = index;
     auto j = 0u;
@@ -307,30 +289,19 @@ string::size_type expectString(const string &input, string::size_type index, con
     return i;
 }
 
-string::size_type skipWhitespaces(const string &input, string::size_type index)
-{
-    while (index != input.size())
-    {
-        auto ch = input[index];
-        if (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t')
-            index++;
-        else
-            break;
-    }
-    return index;
-}
-
-inline bool isHexLiteral(const string &input, string::size_type index)
-{
-    return index + 1 < input.size() && (input[index + 1] == 'x' || input[index + 1] == 'X');
-}
-
-inline bool isOctalLiteral(const string &input, string::size_type index)
+size_type cppjson::detail::skipWhitespaces(std::string_view input, size_type index)
 {
-    return index + 1 < input.size() && input[index] == '0' && isdigit(input[index + 1]);
+    // Values are mostly separated by no or a single whitespace, which isn't worth calling
+    // a kernel for. Runs of indentation are left to the vectorized ones.
+    if (index == input.size() || !isWhitespace(input[index]))
+        return index;
+    if (++index == input.size() || !isWhitespace(input[index]))
+        return index;
+
+    return scanKernels().skipWhitespace(input.data(), input.size(), index);
 }
 
-std::pair<char16_t, string::size_type> parseUTF16EscapedValue(const string &input, string::size_type index)
+std::pair<char16_t, size_type> parseUTF16EscapedValue(std::string_view input, size_type index)
 {
     char digitBuffer[5];
     writeHexValueToBuffer(digitBuffer, input, index + 2);
@@ -353,16 +324,19 @@ char32_t calculateCodepoint(char16_t leadSurroatge, char16_t trailSurrogate)
     return (static_cast<char32_t>(leadSurroatge - 0xD800u) << 10) + (trailSurrogate - 0xDC00u) + 0x10000;
 }
 
-void writeAsUTF8CodeUnits(std::ostringstream &oss, char32_t codepoint)
+// Writes the UTF-8 code units of `codepoint` to `out` and returns how many were written.
+std::size_t writeAsUTF8CodeUnits(char *out, char32_t codepoint)
 {
     if (codepoint <= 0x00007F)
     {
-        oss << static_cast<char>(codepoint);
+        out[0] = static_cast<char>(codepoint);
+        return 1;
     }
     else if (codepoint <= 0x0007FF)
     {
-        oss << static_cast<char>(0b11000000 | (codepoint >> 6));
-        oss << static_cast<char>(0b10000000 | (codepoint & 0b111111));
+        out[0] = static_cast<char>(0b11000000 | (codepoint >> 6));
+        out[1] = static_cast<char>(0b10000000 | (codepoint & 0b111111));
+        return 2;
     }
     else if (codepoint <= 0x00FFFF)
     {
@@ -372,16 +346,18 @@ void writeAsUTF8CodeUnits(std::ostringstream &oss, char32_t codepoint)
         // translate it to correspondent UTF-8 codeunits as if it was a normal unicode character
         // for this is how JSON.parse(...) behaves in browser.
 
-        oss << static_cast<char>(0b11100000 | (codepoint >> 12));
-        oss << static_cast<char>(0b10000000 | ((codepoint >> 6) & 0b111111));
-        oss << static_cast<char>(0b10000000 | (codepoint & 0b111111));
+        out[0] = static_cast<char>(0b11100000 | (codepoint >> 12));
+        out[1] = static_cast<char>(0b10000000 | ((codepoint >> 6) & 0b111111));
+        out[2] = static_cast<char>(0b10000000 | (codepoint & 0b111111));
+        return 3;
     }
     else if (codepoint <= 0x10FFFF)
     {
-        oss << static_cast<char>(0b11110000 | (codepoint >> 18));
-        oss << static_cast<char>(0b10000000 | (codepoint >> 12) & 0b111111);
-        oss << static_cast<char>(0b10000000 | (codepoint >> 6) & 0b111111);
-        oss << static_cast<char>(0b10000000 | (codepoint & 0b111111));
+        out[0] = static_cast<char>(0b11110000 | (codepoint >> 18));
+        out[1] = static_cast<char>(0b10000000 | (codepoint >> 12) & 0b111111);
+        out[2] = static_cast<char>(0b10000000 | (codepoint >> 6) & 0b111111);
+        out[3] = static_cast<char>(0b10000000 | (codepoint & 0b111111));
+        return 4;
     }
     else
     {
@@ -389,9 +365,9 @@ void writeAsUTF8CodeUnits(std::ostringstream &oss, char32_t codepoint)
     }
 }
 
-void writeHexValueToBuffer(char xdigits[], const string &input, string::size_type index)
+void writeHexValueToBuffer(char xdigits[], std::string_view input, size_type index)
 {
-    if (index + 4 >= input.size())
+    if (index + 4 > input.size())
         throw SyntaxError();
 
     for (auto i = 0; i < 4; i++)
@@ -0,0 +1,76 @@
+#ifndef CPP_JSON_PARSER
+#define CPP_JSON_PARSER
+
+#include <array>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cppjson.hpp"
+#include "sax.hpp"
+
+/**
+ * @brief The parser behind `parse()` and `JSON::Document::parse()`: a `SaxReader` handler
+ * that builds the tree.
+ *
+ * Every value is built in the slot it will finally live in (the root, an array element or
+ * an object member), so subtrees are never copied or moved once they are built, whatever
+ * their depth is. The open containers are kept on a stack, which lives on the C++ stack up
+ * to a depth of `InlineDepth`.
+ *
+ * If an arena is given, every array, object and long string it creates is allocated from
+ * the arena, see `JSON::makeArray()` and friends. `buffer` is the scratch space strings
+ * are decoded into before they are stored, it is reused for every string of the input.
+ *
+ * In in-situ mode, `inSitu` is the mutable buffer `input` views: strings are decoded in it
+ * and borrowed from it instead. With `borrowInput`, the strings without escape sequences
+ * are borrowed from `input`, which must outlive the tree, and the others are stored as
+ * usual. With a key pool, object keys are interned in it, see `KeyPool`.
+ */
+class Parser
+{
+public:
+    Parser(std::string_view input, std::string &buffer, std::pmr::memory_resource *arena = nullptr, char *inSitu = nullptr, bool borrowInput = false, KeyPool *keys = nullptr)
+        : input(input), buffer(buffer), arena(arena), inSitu(inSitu), borrowInput(borrowInput), keys(keys),
+          stackArena(stackBlock.data(), stackBlock.size()), stack(&stackArena)
+    {
+        stack.reserve(InlineDepth);
+    }
+
+    void parse(JSON &out);
+    // Sets the slot the value is built into, for when the events come from another reader.
+    void start(JSON &out) { root = &out; }
+
+    void onNull() { *slot() = nullptr; }
+    void onBool(bool value) { *slot() = value; }
+    void onNumber(const JSON &value) { *slot() = value; }
+    void onString(std::string_view value);
+    void onKey(std::string_view key);
+    void onStartObject();
+    void onEndObject() { stack.pop_back(); }
+    void onStartArray();
+    void onEndArray() { stack.pop_back(); }
+
+private:
+    static constexpr std::size_t InlineDepth = 128;
+
+    std::string_view input;
+    std::string &buffer;
+    std::pmr::memory_resource *arena;
+    char *inSitu;
+    bool borrowInput;
+    KeyPool *keys;
+
+    JSON *root = nullptr;
+    // The member the next value is parsed into, set by `onKey`.
+    JSON *member = nullptr;
+
+    alignas(JSON *) std::array<char, InlineDepth * sizeof(JSON *)> stackBlock;
+    std::pmr::monotonic_buffer_resource stackArena;
+    std::pmr::vector<JSON *> stack;
+
+    JSON *slot();
+};
+
+#endif
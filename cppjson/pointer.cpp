@@ -0,0 +1,169 @@
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "cppjson.hpp"
+#include "parser.hpp"
+#include "tape.hpp"
+
+using namespace cppjson::detail;
+
+/**
+ * @brief Compiles `pointer`, see `JSONPointer`.
+ */
+JSONPointer::JSONPointer(std::string_view pointer)
+{
+    if (pointer.empty())
+        return;
+    if (pointer[0] != '/')
+        throw std::invalid_argument("A JSON Pointer starts with '/'");
+
+    std::size_t begin = 1;
+    while (true)
+    {
+        auto end = std::min(pointer.find('/', begin), pointer.size());
+        auto raw = pointer.substr(begin, end - begin);
+
+        Token token;
+        for (std::size_t i = 0; i < raw.size(); i++)
+        {
+            if (raw[i] != '~')
+                token.name += raw[i];
+            else if (i + 1 < raw.size() && (raw[i + 1] == '0' || raw[i + 1] == '1'))
+                token.name += raw[++i] == '0' ? '~' : '/';
+            else
+                throw std::invalid_argument("'~' must be followed by '0' or '1' in a JSON Pointer");
+        }
+        token.hash = JSON::ObjectMap::hash(token.name);
+
+        // An index is "0" or digits without a leading zero. "-", the element after the last
+        // one, never refers to an existing value, so it isn't an index either.
+        token.index = NotAnIndex;
+        auto &name = token.name;
+        if (!name.empty() && name.size() <= 18 && (name == "0" || name[0] != '0') &&
+            name.find_first_not_of("0123456789") == std::string::npos)
+            token.index = std::stoull(name);
+
+        tokens.push_back(std::move(token));
+        if (end == pointer.size())
+            return;
+        begin = end + 1;
+    }
+}
+
+// Follows the tokens from `root`, through the const or the non-const accessors.
+template <typename Tokens, typename Value>
+static Value *follow(const Tokens &tokens, Value &root)
+{
+    auto value = &root;
+    for (auto &token : tokens)
+    {
+        if (value->isObject())
+        {
+            auto &members = value->getObject();
+            auto iter = members.find(token.name, token.hash);
+            if (iter == members.end())
+                return nullptr;
+            value = &iter->second;
+        }
+        else if (value->isArray())
+        {
+            // `NotAnIndex` is larger than any size.
+            auto &items = value->getArray();
+            if (token.index >= items.size())
+                return nullptr;
+            value = &items[token.index];
+        }
+        else
+            return nullptr;
+    }
+    return value;
+}
+
+const JSON *JSONPointer::find(const JSON &root) const
+{
+    return follow(tokens, root);
+}
+
+JSON *JSONPointer::find(JSON &root) const
+{
+    return follow(tokens, root);
+}
+
+// Moves from the member or element just skipped to the next one. Returns false at the end
+// of the container, whose closing character is `close`.
+static bool nextMember(std::string_view input, size_type &index, char close)
+{
+    index = skipWhitespaces(input, index);
+    if (index == input.size())
+        throw SyntaxError();
+    if (input[index] == close)
+        return false;
+    if (input[index] != ',')
+        throw SyntaxError();
+    index = skipWhitespaces(input, index + 1);
+    return true;
+}
+
+/**
+ * @brief Follows the pointer through `input`, see `JSONPointer`.
+ */
+std::optional<JSON> JSONPointer::extract(std::string_view input) const
+{
+    std::string buffer;
+    auto index = skipWhitespaces(input, 0);
+
+    for (auto &token : tokens)
+    {
+        if (index == input.size())
+            throw SyntaxError();
+
+        auto ch = input[index];
+        if (ch == '{')
+        {
+            index = skipWhitespaces(input, index + 1);
+            if (index != input.size() && input[index] == '}')
+                return std::nullopt;
+
+            while (true)
+            {
+                if (index == input.size() || input[index] != '"')
+                    throw SyntaxError();
+
+                std::string_view key;
+                index = parseStringLiteral(input, index, buffer, nullptr, key);
+                index = expectString(input, skipWhitespaces(input, index), ":");
+                index = skipWhitespaces(input, index);
+                if (key == token.name)
+                    break;
+
+                index = skipValue(input, index);
+                if (!nextMember(input, index, '}'))
+                    return std::nullopt;
+            }
+        }
+        else if (ch == '[')
+        {
+            if (token.index == NotAnIndex)
+                return std::nullopt;
+
+            index = skipWhitespaces(input, index + 1);
+            if (index != input.size() && input[index] == ']')
+                return std::nullopt;
+
+            for (std::size_t i = 0; i < token.index; i++)
+            {
+                index = skipValue(input, index);
+                if (!nextMember(input, index, ']'))
+                    return std::nullopt;
+            }
+        }
+        else
+            return std::nullopt;
+    }
+
+    auto end = skipValue(input, index);
+    return parse(input.substr(index, end - index));
+}
@@ -0,0 +1,166 @@
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cppjson.hpp"
+#include "parser.hpp"
+#include "projection.hpp"
+#include "tape.hpp"
+
+using namespace cppjson::detail;
+
+Projection::Projection(std::initializer_list<std::string_view> paths)
+{
+    for (auto path : paths)
+        add(path);
+}
+
+Projection::Projection(const std::vector<std::string> &paths)
+{
+    for (auto &path : paths)
+        add(path);
+}
+
+/**
+ * @brief Adds `path`, a JSON Pointer or a top-level key. Throws `std::invalid_argument` for
+ * an invalid JSON Pointer.
+ */
+void Projection::add(std::string_view path)
+{
+    std::vector<std::string> names;
+    if (!path.empty() && path[0] != '/')
+        names.emplace_back(path);
+    else
+    {
+        JSONPointer pointer(path);
+        for (std::size_t i = 0; i < pointer.size(); i++)
+            names.emplace_back(pointer[i]);
+    }
+
+    auto node = &root;
+    for (auto &name : names)
+    {
+        // A value kept whole keeps the paths below it too.
+        if (node->keep)
+            return;
+
+        auto &children = node->children;
+        auto iter = children.begin();
+        while (iter != children.end() && iter->name != name)
+            iter++;
+        if (iter == children.end())
+        {
+            children.push_back(Node{name, false, {}});
+            iter = children.end() - 1;
+        }
+        node = &*iter;
+    }
+
+    node->keep = true;
+    node->children.clear();
+}
+
+// Builds the kept values of the input in place, see `Projection`.
+class ProjectedParser
+{
+public:
+    ProjectedParser(std::string_view input, KeyPool *keys) : input(input), keys(keys) {}
+
+    // Parses the value at `index` into `out` as `node` projects it, and returns the index
+    // right after it.
+    template <typename Node>
+    size_type parseValue(size_type index, const Node &node, JSON &out)
+    {
+        if (index == input.size())
+            throw SyntaxError();
+
+        auto ch = input[index];
+        if (node.keep || (ch != '{' && ch != '['))
+        {
+            auto end = skipValue(input, index);
+            Parser(input.substr(index, end - index), buffer, nullptr, nullptr, false, keys).parse(out);
+            return end;
+        }
+        return ch == '{' ? parseObject(index, node, out) : parseArray(index, node, out);
+    }
+
+private:
+    std::string_view input;
+    KeyPool *keys;
+    std::string buffer;
+
+    template <typename Node>
+    size_type parseObject(size_type index, const Node &node, JSON &out)
+    {
+        auto &members = out.makeObject(nullptr);
+        index = skipWhitespaces(input, index + 1);
+        if (index != input.size() && input[index] == '}')
+            return index + 1;
+
+        while (true)
+        {
+            if (index == input.size() || input[index] != '"')
+                throw SyntaxError();
+
+            std::string_view key;
+            index = parseStringLiteral(input, index, buffer, nullptr, key);
+            index = skipWhitespaces(input, expectString(input, skipWhitespaces(input, index), ":"));
+
+            const Node *child = nullptr;
+            for (auto &candidate : node.children)
+                if (candidate.name == key)
+                    child = &candidate;
+
+            if (child)
+            {
+                auto &member = (keys ? members.emplace(JSON::Key(key, *keys), nullptr) : members.emplace(key, nullptr)).first->second;
+                index = parseValue(index, *child, member);
+            }
+            else
+                index = skipValue(input, index);
+
+            index = skipWhitespaces(input, index);
+            if (index == input.size())
+                throw SyntaxError();
+            if (input[index] == '}')
+                return index + 1;
+            if (input[index] != ',')
+                throw SyntaxError();
+            index = skipWhitespaces(input, index + 1);
+        }
+    }
+
+    // The elements of an array are all projected by `node`.
+    template <typename Node>
+    size_type parseArray(size_type index, const Node &node, JSON &out)
+    {
+        auto &items = out.makeArray(nullptr);
+        index = skipWhitespaces(input, index + 1);
+        if (index != input.size() && input[index] == ']')
+            return index + 1;
+
+        while (true)
+        {
+            items.emplace_back(nullptr);
+            index = skipWhitespaces(input, parseValue(index, node, items.back()));
+
+            if (index == input.size())
+                throw SyntaxError();
+            if (input[index] == ']')
+                return index + 1;
+            if (input[index] != ',')
+                throw SyntaxError();
+            index = skipWhitespaces(input, index + 1);
+        }
+    }
+};
+
+JSON parseProjected(std::string_view input, const Projection &projection, KeyPool *keys)
+{
+    JSON result(nullptr);
+    ProjectedParser parser(input, keys);
+    auto index = parser.parseValue(skipWhitespaces(input, 0), projection.root, result);
+    if (skipWhitespaces(input, index) != input.size())
+        throw SyntaxError();
+    return result;
+}
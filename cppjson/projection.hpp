@@ -0,0 +1,11 @@
+#ifndef CPP_JSON_PROJECTION
+#define CPP_JSON_PROJECTION
+
+#include <string_view>
+
+#include "cppjson.hpp"
+
+// Parses the values of `input` that `projection` keeps, see `Projection`.
+JSON parseProjected(std::string_view input, const Projection &projection, KeyPool *keys);
+
+#endif
@@ -0,0 +1,56 @@
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "cppjson.hpp"
+#include "parser.hpp"
+#include "push.hpp"
+
+struct PushParser::State
+{
+    JSON result;
+    std::string buffer;
+    Parser builder;
+    PushReader<Parser> reader;
+
+    State() : result(nullptr), builder(std::string_view(), buffer), reader(builder)
+    {
+        builder.start(result);
+    }
+};
+
+PushParser::PushParser() : state(new State()) {}
+
+PushParser::~PushParser() = default;
+
+void PushParser::feed(const char *data, std::size_t size)
+{
+    state->reader.feed(data, size);
+}
+
+void PushParser::feed(std::string_view chunk)
+{
+    feed(chunk.data(), chunk.size());
+}
+
+JSON PushParser::finish()
+{
+    try
+    {
+        state->reader.finish();
+    }
+    catch (...)
+    {
+        reset();
+        throw;
+    }
+
+    auto result = std::move(state->result);
+    reset();
+    return result;
+}
+
+void PushParser::reset()
+{
+    state.reset(new State());
+}
@@ -0,0 +1,364 @@
+#ifndef CPP_JSON_PUSH
+#define CPP_JSON_PUSH
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cppjson.hpp"
+#include "sax.hpp"
+#include "scan.hpp"
+
+/**
+ * @brief A resumable event parser, fed with the input one chunk at a time, e.g. as it
+ * arrives from the network. Events are reported to the handler, see `SaxReader`, as soon
+ * as the chunk completing them is fed.
+ *
+ * Structural characters are handled as they come, so only a string, number or literal
+ * split across chunks is kept, in the `pending` buffer, until its end arrives. Tokens
+ * within one chunk are read from the chunk directly.
+ *
+ * Errors are thrown as `SyntaxError` by `feed()` once they are seen, or by `finish()` if
+ * the input ends in the middle of a value.
+ */
+template <typename Handler>
+class PushReader
+{
+public:
+    explicit PushReader(Handler &handler) : handler(handler) {}
+
+    void feed(const char *data, std::size_t size)
+    {
+        if (size == 0)
+            return;
+
+        std::string_view chunk(data, size);
+        size_type index = 0;
+
+        if (token != None)
+            index = continueToken(chunk);
+
+        while (true)
+        {
+            index = cppjson::detail::skipWhitespaces(chunk, index);
+            if (index == chunk.size())
+                return;
+
+            auto ch = chunk[index];
+            switch (state)
+            {
+            case FirstValue:
+                if (ch == ']')
+                {
+                    close('[');
+                    index++;
+                    break;
+                }
+                // fall through
+            case Value:
+                index = startValue(chunk, index);
+                break;
+            case FirstKey:
+                if (ch == '}')
+                {
+                    close('{');
+                    index++;
+                    break;
+                }
+                // fall through
+            case Key:
+                if (ch != '"')
+                    throw SyntaxError();
+                index = startString(chunk, index, KeyString);
+                break;
+            case Colon:
+                if (ch != ':')
+                    throw SyntaxError();
+                state = Value;
+                index++;
+                break;
+            case AfterValue:
+                if (ch == ',')
+                    state = stack.back() == '{' ? Key : Value;
+                else if ((ch == '}' || ch == ']') && stack.back() == (ch == '}' ? '{' : '['))
+                    close(stack.back());
+                else
+                    throw SyntaxError();
+                index++;
+                break;
+            case Done:
+                throw SyntaxError();
+            }
+        }
+    }
+
+    void feed(std::string_view chunk)
+    {
+        feed(chunk.data(), chunk.size());
+    }
+
+    // Ends the input, which must have held exactly one value, and resets the reader for
+    // the next one.
+    void finish()
+    {
+        if (token == Number)
+            emitNumber(pending);
+        else if (token == Literal)
+            emitLiteral(pending);
+        else if (token != None)
+            throw SyntaxError();
+
+        if (state != Done)
+            throw SyntaxError();
+
+        reset();
+    }
+
+    // Drops the input fed so far, e.g. after an error.
+    void reset()
+    {
+        state = Value;
+        token = None;
+        escapeAtEnd = false;
+        pending.clear();
+        stack.clear();
+    }
+
+private:
+    using size_type = cppjson::detail::size_type;
+
+    enum State
+    {
+        // A value is expected, in the first case right after a `[`, so the array may end.
+        Value,
+        FirstValue,
+        // A key is expected, in the first case right after a `{`, so the object may end.
+        Key,
+        FirstKey,
+        Colon,
+        AfterValue,
+        // The top-level value is complete, only whitespaces may follow.
+        Done,
+    };
+
+    // The token being read when the last chunk ended.
+    enum Token
+    {
+        None,
+        String,
+        KeyString,
+        Number,
+        Literal,
+    };
+
+    Handler &handler;
+    State state = Value;
+    Token token = None;
+    // Whether the last chunk ended with a backslash inside a string, so the first
+    // character of the next one is escaped.
+    bool escapeAtEnd = false;
+    std::string pending;
+    std::string buffer;
+    // `{` or `[` for every open container.
+    std::vector<char> stack;
+
+    static bool isNumberChar(char ch)
+    {
+        return (ch >= '0' && ch <= '9') || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E';
+    }
+
+    static bool isLiteralChar(char ch)
+    {
+        return ch >= 'a' && ch <= 'z';
+    }
+
+    template <typename Predicate>
+    static size_type scanWhile(std::string_view chunk, size_type index, Predicate predicate)
+    {
+        while (index != chunk.size() && predicate(chunk[index]))
+            index++;
+        return index;
+    }
+
+    // Returns the index right after the closing double-quote of a string whose content
+    // starts at `index`, or `npos` if the chunk ends first.
+    size_type scanString(std::string_view chunk, size_type index)
+    {
+        if (escapeAtEnd)
+        {
+            escapeAtEnd = false;
+            index++;
+        }
+
+        auto findStringSpecial = scanKernels().findStringSpecial;
+        while (true)
+        {
+            index = findStringSpecial(chunk.data(), chunk.size(), index);
+            if (index >= chunk.size())
+                return std::string_view::npos;
+
+            if (chunk[index] == '"')
+                return index + 1;
+            if (chunk[index] == '\\')
+            {
+                if (index + 1 == chunk.size())
+                {
+                    escapeAtEnd = true;
+                    return std::string_view::npos;
+                }
+                index += 2;
+            }
+            else
+                // A control character, `parseStringLiteral` rejects it.
+                index++;
+        }
+    }
+
+    size_type startValue(std::string_view chunk, size_type index)
+    {
+        auto ch = chunk[index];
+        if (ch == '{' || ch == '[')
+        {
+            if (ch == '{')
+                handler.onStartObject();
+            else
+                handler.onStartArray();
+            stack.push_back(ch);
+            state = ch == '{' ? FirstKey : FirstValue;
+            return index + 1;
+        }
+        else if (ch == '"')
+            return startString(chunk, index, String);
+        else if ((ch >= '0' && ch <= '9') || ch == '-')
+            return startScalar(chunk, index, Number, isNumberChar);
+        else if (ch == 't' || ch == 'f' || ch == 'n')
+            return startScalar(chunk, index, Literal, isLiteralChar);
+        else
+            throw SyntaxError();
+    }
+
+    size_type startString(std::string_view chunk, size_type index, Token kind)
+    {
+        auto end = scanString(chunk, index + 1);
+        if (end == std::string_view::npos)
+        {
+            pending.assign(chunk.substr(index));
+            token = kind;
+            return chunk.size();
+        }
+
+        emitString(chunk.substr(index, end - index), kind);
+        return end;
+    }
+
+    template <typename Predicate>
+    size_type startScalar(std::string_view chunk, size_type index, Token kind, Predicate predicate)
+    {
+        auto end = scanWhile(chunk, index, predicate);
+        if (end == chunk.size())
+        {
+            // The token may go on in the next chunk.
+            pending.assign(chunk.substr(index));
+            token = kind;
+            return end;
+        }
+
+        if (kind == Number)
+            emitNumber(chunk.substr(index, end - index));
+        else
+            emitLiteral(chunk.substr(index, end - index));
+        return end;
+    }
+
+    size_type continueToken(std::string_view chunk)
+    {
+        size_type end;
+        if (token == String || token == KeyString)
+        {
+            end = scanString(chunk, 0);
+            if (end == std::string_view::npos)
+            {
+                pending.append(chunk);
+                return chunk.size();
+            }
+        }
+        else
+        {
+            end = scanWhile(chunk, 0, token == Number ? isNumberChar : isLiteralChar);
+            if (end == chunk.size())
+            {
+                pending.append(chunk);
+                return chunk.size();
+            }
+        }
+
+        pending.append(chunk.substr(0, end));
+        auto kind = token;
+        token = None;
+
+        if (kind == Number)
+            emitNumber(pending);
+        else if (kind == Literal)
+            emitLiteral(pending);
+        else
+            emitString(pending, kind);
+        pending.clear();
+        return end;
+    }
+
+    void emitString(std::string_view literal, Token kind)
+    {
+        std::string_view value;
+        cppjson::detail::parseStringLiteral(literal, 0, buffer, nullptr, value);
+        if (kind == KeyString)
+        {
+            handler.onKey(value);
+            state = Colon;
+        }
+        else
+        {
+            handler.onString(value);
+            endValue();
+        }
+    }
+
+    void emitNumber(std::string_view literal)
+    {
+        JSON number(nullptr);
+        if (cppjson::detail::parseNumberLiteral(literal, 0, number) != literal.size())
+            throw SyntaxError();
+        handler.onNumber(number);
+        endValue();
+    }
+
+    void emitLiteral(std::string_view literal)
+    {
+        if (literal == "true")
+            handler.onBool(true);
+        else if (literal == "false")
+            handler.onBool(false);
+        else if (literal == "null")
+            handler.onNull();
+        else
+            throw SyntaxError();
+        endValue();
+    }
+
+    void close(char open)
+    {
+        stack.pop_back();
+        if (open == '{')
+            handler.onEndObject();
+        else
+            handler.onEndArray();
+        endValue();
+    }
+
+    void endValue()
+    {
+        state = stack.empty() ? Done : AfterValue;
+    }
+};
+
+#endif
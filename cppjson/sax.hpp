@@ -0,0 +1,199 @@
+#ifndef CPP_JSON_SAX
+#define CPP_JSON_SAX
+
+#include <string>
+#include <string_view>
+
+#include "cppjson.hpp"
+
+// The lexical routines, shared by every parsing engine. They are internal, so they live in
+// `cppjson::detail` rather than next to the public API.
+namespace cppjson::detail
+{
+    using size_type = std::string_view::size_type;
+
+    size_type parseStringLiteral(std::string_view input, size_type index, std::string &buffer, char *inSitu, std::string_view &value);
+    size_type parseNumberLiteral(std::string_view input, size_type index, JSON &value);
+    size_type expectString(std::string_view input, size_type index, std::string_view keyword);
+    size_type skipWhitespaces(std::string_view input, size_type index);
+}
+
+/**
+ * @brief An event parser, which reports the values of the input to a handler in document
+ * order instead of building a tree.
+ *
+ * The handler is any class with these member functions:
+ *
+ *     void onNull();
+ *     void onBool(bool value);
+ *     void onNumber(const JSON &value);      // an int64, uint64 or double number
+ *     void onString(std::string_view value);
+ *     void onKey(std::string_view key);      // an object key, followed by its value
+ *     void onStartObject();
+ *     void onEndObject();
+ *     void onStartArray();
+ *     void onEndArray();
+ *
+ * The views passed to `onString` and `onKey` point into the input, or into a scratch buffer
+ * for strings with escape sequences, and are only valid during the call. Inputs without
+ * escape sequences are parsed without any allocation.
+ *
+ * Errors are thrown as `SyntaxError`, possibly after some events have been reported.
+ */
+template <typename Handler>
+class SaxReader
+{
+public:
+    SaxReader(std::string_view input, Handler &handler, std::string &buffer, char *inSitu = nullptr)
+        : input(input), handler(handler), buffer(buffer), inSitu(inSitu) {}
+
+    // Parses the whole input, which must hold exactly one value.
+    void parse()
+    {
+        auto index = parseValue(cppjson::detail::skipWhitespaces(input, 0));
+        if (cppjson::detail::skipWhitespaces(input, index) != input.size())
+            throw SyntaxError();
+    }
+
+private:
+    using size_type = cppjson::detail::size_type;
+
+    std::string_view input;
+    Handler &handler;
+    std::string &buffer;
+    char *inSitu;
+
+    // Every function parses the value starting at `index`, which has been checked to be
+    // the first character of a value, and returns the index right after it.
+
+    size_type parseValue(size_type index)
+    {
+        if (index == input.size())
+            throw SyntaxError();
+
+        auto ch = input[index];
+        if (ch == '{')
+            return parseObject(index);
+        else if (ch == '[')
+            return parseArray(index);
+        else if (ch == '"')
+        {
+            std::string_view str;
+            index = cppjson::detail::parseStringLiteral(input, index, buffer, inSitu, str);
+            handler.onString(str);
+            return index;
+        }
+        else if ((ch >= '0' && ch <= '9') || ch == '-')
+        {
+            JSON number(nullptr);
+            index = cppjson::detail::parseNumberLiteral(input, index, number);
+            handler.onNumber(number);
+            return index;
+        }
+        else if (ch == 't')
+        {
+            index = cppjson::detail::expectString(input, index, "true");
+            handler.onBool(true);
+            return index;
+        }
+        else if (ch == 'f')
+        {
+            index = cppjson::detail::expectString(input, index, "false");
+            handler.onBool(false);
+            return index;
+        }
+        else if (ch == 'n')
+        {
+            index = cppjson::detail::expectString(input, index, "null");
+            handler.onNull();
+            return index;
+        }
+        else
+            throw SyntaxError();
+    }
+
+    size_type parseObject(size_type index)
+    {
+        handler.onStartObject();
+        index = cppjson::detail::skipWhitespaces(input, index + 1);
+
+        if (index == input.size())
+            throw SyntaxError();
+        if (input[index] == '}')
+        {
+            handler.onEndObject();
+            return index + 1;
+        }
+
+        while (true)
+        {
+            if (index == input.size() || input[index] != '"')
+                throw SyntaxError();
+
+            std::string_view key;
+            index = cppjson::detail::parseStringLiteral(input, index, buffer, inSitu, key);
+            handler.onKey(key);
+
+            index = cppjson::detail::skipWhitespaces(input, index);
+            index = cppjson::detail::expectString(input, index, ":");
+            index = parseValue(cppjson::detail::skipWhitespaces(input, index));
+            index = cppjson::detail::skipWhitespaces(input, index);
+
+            if (index == input.size())
+                throw SyntaxError();
+            else if (input[index] == '}')
+            {
+                handler.onEndObject();
+                return index + 1;
+            }
+            else if (input[index] == ',')
+                index = cppjson::detail::skipWhitespaces(input, index + 1);
+            else
+                throw SyntaxError();
+        }
+    }
+
+    size_type parseArray(size_type index)
+    {
+        handler.onStartArray();
+        index = cppjson::detail::skipWhitespaces(input, index + 1);
+
+        if (index == input.size())
+            throw SyntaxError();
+        if (input[index] == ']')
+        {
+            handler.onEndArray();
+            return index + 1;
+        }
+
+        while (true)
+        {
+            index = parseValue(index);
+            index = cppjson::detail::skipWhitespaces(input, index);
+
+            if (index == input.size())
+                throw SyntaxError();
+            else if (input[index] == ']')
+            {
+                handler.onEndArray();
+                return index + 1;
+            }
+            else if (input[index] == ',')
+                index = cppjson::detail::skipWhitespaces(input, index + 1);
+            else
+                throw SyntaxError();
+        }
+    }
+};
+
+/**
+ * @brief Parses `str`, reporting its values to `handler`, see `SaxReader`.
+ */
+template <typename Handler>
+void parseEvents(std::string_view str, Handler &handler)
+{
+    std::string buffer;
+    SaxReader<Handler>(str, handler, buffer).parse();
+}
+
+#endif
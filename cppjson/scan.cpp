@@ -0,0 +1,259 @@
+#include <cstddef>
+#include <vector>
+
+#include "scan.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CPP_JSON_X86 1
+#include <immintrin.h>
+#endif
+
+static std::size_t skipWhitespaceScalar(const char *data, std::size_t size, std::size_t index)
+{
+    while (index < size && isWhitespace(data[index]))
+        index++;
+    return index;
+}
+
+static std::size_t findStringSpecialScalar(const char *data, std::size_t size, std::size_t index)
+{
+    while (index < size && !isStringSpecial(data[index]))
+        index++;
+    return index;
+}
+
+static std::size_t findEscapeOrNonAsciiScalar(const char *data, std::size_t size, std::size_t index)
+{
+    while (index < size && !isStringSpecial(data[index]) && static_cast<unsigned char>(data[index]) < 0x80u)
+        index++;
+    return index;
+}
+
+static void classifyScalar(const char *block, BlockMasks &masks)
+{
+    masks = BlockMasks();
+    for (auto i = 0; i < 64; i++)
+    {
+        auto bit = std::uint64_t(1) << i;
+        auto ch = block[i];
+        if (isWhitespace(ch))
+            masks.whitespace |= bit;
+        else if (isStructuralOp(ch))
+            masks.op |= bit;
+        else if (ch == '"')
+            masks.quote |= bit;
+        else if (ch == '\\')
+            masks.backslash |= bit;
+    }
+}
+
+#ifdef CPP_JSON_X86
+
+// The vector kernels compare a whole block against the bytes they look for, turn the
+// result into a bit mask with one bit per byte, and stop at its lowest set bit. The last
+// bytes that don't fill a block are left to the scalar kernel.
+
+__attribute__((target("sse2"))) static std::size_t skipWhitespaceSSE2(const char *data, std::size_t size, std::size_t index)
+{
+    const auto space = _mm_set1_epi8(' ');
+    const auto newline = _mm_set1_epi8('\n');
+    const auto carriageReturn = _mm_set1_epi8('\r');
+    const auto tab = _mm_set1_epi8('\t');
+
+    for (; index + 16 <= size; index += 16)
+    {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index));
+        auto whitespace = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, newline)),
+            _mm_or_si128(_mm_cmpeq_epi8(block, carriageReturn), _mm_cmpeq_epi8(block, tab)));
+
+        auto mask = ~static_cast<unsigned>(_mm_movemask_epi8(whitespace)) & 0xFFFFu;
+        if (mask)
+            return index + __builtin_ctz(mask);
+    }
+
+    return skipWhitespaceScalar(data, size, index);
+}
+
+__attribute__((target("sse2"))) static std::size_t findStringSpecialSSE2(const char *data, std::size_t size, std::size_t index)
+{
+    const auto quote = _mm_set1_epi8('"');
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto lastControl = _mm_set1_epi8(0x1F);
+
+    for (; index + 16 <= size; index += 16)
+    {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index));
+        // An unsigned byte is at most 0x1F if max(byte, 0x1F) is 0x1F.
+        auto control = _mm_cmpeq_epi8(_mm_max_epu8(block, lastControl), lastControl);
+        auto special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)),
+            control);
+
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+        if (mask)
+            return index + __builtin_ctz(mask);
+    }
+
+    return findStringSpecialScalar(data, size, index);
+}
+
+__attribute__((target("sse2"))) static std::size_t findEscapeOrNonAsciiSSE2(const char *data, std::size_t size, std::size_t index)
+{
+    const auto quote = _mm_set1_epi8('"');
+    const auto backslash = _mm_set1_epi8('\\');
+    const auto lastControl = _mm_set1_epi8(0x1F);
+
+    for (; index + 16 <= size; index += 16)
+    {
+        auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index));
+        auto control = _mm_cmpeq_epi8(_mm_max_epu8(block, lastControl), lastControl);
+        auto special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)),
+            control);
+
+        // The high bit of every byte is the non-ASCII mask already.
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(special, block)));
+        if (mask)
+            return index + __builtin_ctz(mask);
+    }
+
+    return findEscapeOrNonAsciiScalar(data, size, index);
+}
+
+__attribute__((target("avx2"))) static std::size_t skipWhitespaceAVX2(const char *data, std::size_t size, std::size_t index)
+{
+    const auto space = _mm256_set1_epi8(' ');
+    const auto newline = _mm256_set1_epi8('\n');
+    const auto carriageReturn = _mm256_set1_epi8('\r');
+    const auto tab = _mm256_set1_epi8('\t');
+
+    for (; index + 32 <= size; index += 32)
+    {
+        auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + index));
+        auto whitespace = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, newline)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, carriageReturn), _mm256_cmpeq_epi8(block, tab)));
+
+        auto mask = ~static_cast<unsigned>(_mm256_movemask_epi8(whitespace));
+        if (mask)
+            return index + __builtin_ctz(mask);
+    }
+
+    return skipWhitespaceSSE2(data, size, index);
+}
+
+__attribute__((target("avx2"))) static std::size_t findStringSpecialAVX2(const char *data, std::size_t size, std::size_t index)
+{
+    const auto quote = _mm256_set1_epi8('"');
+    const auto backslash = _mm256_set1_epi8('\\');
+    const auto lastControl = _mm256_set1_epi8(0x1F);
+
+    for (; index + 32 <= size; index += 32)
+    {
+        auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + index));
+        auto control = _mm256_cmpeq_epi8(_mm256_max_epu8(block, lastControl), lastControl);
+        auto special = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash)),
+            control);
+
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(special));
+        if (mask)
+            return index + __builtin_ctz(mask);
+    }
+
+    return findStringSpecialSSE2(data, size, index);
+}
+
+__attribute__((target("avx2"))) static std::size_t findEscapeOrNonAsciiAVX2(const char *data, std::size_t size, std::size_t index)
+{
+    const auto quote = _mm256_set1_epi8('"');
+    const auto backslash = _mm256_set1_epi8('\\');
+    const auto lastControl = _mm256_set1_epi8(0x1F);
+
+    for (; index + 32 <= size; index += 32)
+    {
+        auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + index));
+        auto control = _mm256_cmpeq_epi8(_mm256_max_epu8(block, lastControl), lastControl);
+        auto special = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash)),
+            control);
+
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(special, block)));
+        if (mask)
+            return index + __builtin_ctz(mask);
+    }
+
+    return findEscapeOrNonAsciiSSE2(data, size, index);
+}
+
+__attribute__((target("sse2"))) static void classifySSE2(const char *block, BlockMasks &masks)
+{
+    masks = BlockMasks();
+    for (auto i = 0; i < 64; i += 16)
+    {
+        auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+        auto is = [bytes](char ch)
+        { return _mm_cmpeq_epi8(bytes, _mm_set1_epi8(ch)); };
+        auto bits = [](__m128i matches)
+        { return static_cast<std::uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(matches))); };
+
+        masks.whitespace |= bits(_mm_or_si128(_mm_or_si128(is(' '), is('\n')), _mm_or_si128(is('\r'), is('\t')))) << i;
+        masks.op |= bits(_mm_or_si128(
+                            _mm_or_si128(_mm_or_si128(is('{'), is('}')), _mm_or_si128(is('['), is(']'))),
+                            _mm_or_si128(is(':'), is(','))))
+                    << i;
+        masks.quote |= bits(is('"')) << i;
+        masks.backslash |= bits(is('\\')) << i;
+    }
+}
+
+__attribute__((target("avx2"))) static void classifyAVX2(const char *block, BlockMasks &masks)
+{
+    masks = BlockMasks();
+    for (auto i = 0; i < 64; i += 32)
+    {
+        auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i));
+        auto is = [bytes](char ch) __attribute__((target("avx2")))
+        { return _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(ch)); };
+        auto bits = [](__m256i matches) __attribute__((target("avx2")))
+        { return static_cast<std::uint64_t>(static_cast<unsigned>(_mm256_movemask_epi8(matches))); };
+
+        masks.whitespace |= bits(_mm256_or_si256(_mm256_or_si256(is(' '), is('\n')), _mm256_or_si256(is('\r'), is('\t')))) << i;
+        masks.op |= bits(_mm256_or_si256(
+                            _mm256_or_si256(_mm256_or_si256(is('{'), is('}')), _mm256_or_si256(is('['), is(']'))),
+                            _mm256_or_si256(is(':'), is(','))))
+                    << i;
+        masks.quote |= bits(is('"')) << i;
+        masks.backslash |= bits(is('\\')) << i;
+    }
+}
+
+#endif
+
+const std::vector<ScanKernels> &availableScanKernels()
+{
+    static const std::vector<ScanKernels> kernels = []()
+    {
+        std::vector<ScanKernels> kernels = {{"scalar", skipWhitespaceScalar, findStringSpecialScalar, findEscapeOrNonAsciiScalar, classifyScalar}};
+#ifdef CPP_JSON_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse2"))
+            kernels.push_back({"sse2", skipWhitespaceSSE2, findStringSpecialSSE2, findEscapeOrNonAsciiSSE2, classifySSE2});
+        if (__builtin_cpu_supports("avx2"))
+            kernels.push_back({"avx2", skipWhitespaceAVX2, findStringSpecialAVX2, findEscapeOrNonAsciiAVX2, classifyAVX2});
+#endif
+        return kernels;
+    }();
+
+    return kernels;
+}
+
+const ScanKernels &scanKernels()
+{
+    static const ScanKernels &best = availableScanKernels().back();
+    return best;
+}
+
+// Choose the kernels while the program starts, rather than during the first parse.
+static const ScanKernels &startupKernels = scanKernels();
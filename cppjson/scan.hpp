@@ -0,0 +1,69 @@
+#ifndef CPP_JSON_SCAN
+#define CPP_JSON_SCAN
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Kernels that scan the input many bytes at a time.
+ *
+ * The scanning kernels take the whole input and the index to start from, and return the
+ * index of the first byte at or after `index` they stop at, or `size` if there is none.
+ * `skipWhitespace` stops at the first byte that isn't a JSON whitespace, and
+ * `findStringSpecial` at the first byte a string literal can't simply copy: a
+ * double-quote, a backslash or a control character (below 0x20). These are also the bytes
+ * the serializer has to escape, and `findEscapeOrNonAscii` stops at non-ASCII bytes as well,
+ * for when they are escaped too.
+ *
+ * `classify` sorts the bytes of one 64-byte block into the masks below, it is the first
+ * step of building a structural index.
+ */
+using ScanFunction = std::size_t (*)(const char *data, std::size_t size, std::size_t index);
+
+/**
+ * @brief The classes of the bytes of a 64-byte block, bit `i` of a mask stands for byte `i`.
+ *
+ * `op` marks the structural characters `{`, `}`, `[`, `]`, `:` and `,`.
+ */
+struct BlockMasks
+{
+    std::uint64_t whitespace;
+    std::uint64_t op;
+    std::uint64_t quote;
+    std::uint64_t backslash;
+};
+
+using ClassifyFunction = void (*)(const char *block, BlockMasks &masks);
+
+struct ScanKernels
+{
+    const char *name;
+    ScanFunction skipWhitespace;
+    ScanFunction findStringSpecial;
+    ScanFunction findEscapeOrNonAscii;
+    ClassifyFunction classify;
+};
+
+// Every implementation the running CPU supports, starting with the portable scalar one.
+const std::vector<ScanKernels> &availableScanKernels();
+
+// The fastest implementation the running CPU supports, chosen once at startup.
+const ScanKernels &scanKernels();
+
+inline bool isWhitespace(char ch)
+{
+    return ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t';
+}
+
+inline bool isStructuralOp(char ch)
+{
+    return ch == '{' || ch == '}' || ch == '[' || ch == ']' || ch == ':' || ch == ',';
+}
+
+inline bool isStringSpecial(char ch)
+{
+    return ch == '"' || ch == '\\' || static_cast<unsigned char>(ch) < 0x20u;
+}
+
+#endif
@@ -0,0 +1,436 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cppjson.hpp"
+#include "parser.hpp"
+#include "scan.hpp"
+#include "tape.hpp"
+
+using namespace cppjson::detail;
+
+// Computes, for every bit, the XOR of it and all the bits below it. Applied to the quotes
+// of a block, this sets the bits from an opening quote up to, but not including, its
+// closing quote.
+static std::uint64_t prefixXor(std::uint64_t bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+// Returns the bits of the characters escaped by a backslash, i.e. the ones right after a
+// run of backslashes of odd length. Runs are told apart by the parity of the bit they
+// start on, and the additions carry each start to the end of its run. `endsOddRun`
+// carries a run that goes on into the next block.
+static std::uint64_t findEscaped(std::uint64_t backslash, std::uint64_t &endsOddRun)
+{
+    const std::uint64_t evenBits = 0x5555555555555555ULL;
+    const std::uint64_t oddBits = ~evenBits;
+
+    auto startEdges = backslash & ~(backslash << 1);
+    // A run continuing from the previous block has its parity flipped.
+    auto evenStartMask = evenBits ^ endsOddRun;
+    auto evenStarts = startEdges & evenStartMask;
+    auto oddStarts = startEdges & ~evenStartMask;
+
+    auto evenCarries = backslash + evenStarts;
+    std::uint64_t oddCarries;
+    auto overflow = __builtin_add_overflow(backslash, oddStarts, &oddCarries);
+    oddCarries |= endsOddRun;
+    endsOddRun = overflow ? 1 : 0;
+
+    auto evenCarryEnds = evenCarries & ~backslash;
+    auto oddCarryEnds = oddCarries & ~backslash;
+    return (evenCarryEnds & oddBits) | (oddCarryEnds & evenBits);
+}
+
+void classifyBlock(std::string_view input, std::size_t offset, BlockMasks &masks)
+{
+    auto classify = scanKernels().classify;
+    if (offset + 64 <= input.size())
+    {
+        classify(input.data() + offset, masks);
+    }
+    else
+    {
+        // The last block is padded with whitespaces.
+        char block[64];
+        std::memset(block, ' ', sizeof(block));
+        std::memcpy(block, input.data() + offset, input.size() - offset);
+        classify(block, masks);
+    }
+}
+
+std::uint64_t StringTracker::next(BlockMasks &masks)
+{
+    masks.quote &= ~findEscaped(masks.backslash, endsOddRun);
+    auto inString = prefixXor(masks.quote) ^ endsInString;
+    endsInString = inString >> 63 ? ~std::uint64_t(0) : 0;
+    return inString;
+}
+
+void buildStructuralIndex(std::string_view input, std::vector<std::uint32_t> &positions)
+{
+    positions.clear();
+
+    StringTracker strings;
+    std::uint64_t endsInScalar = 0;
+
+    for (std::size_t offset = 0; offset < input.size(); offset += 64)
+    {
+        BlockMasks masks;
+        classifyBlock(input, offset, masks);
+        auto inString = strings.next(masks);
+
+        // Any other character outside strings belongs to a literal, a number, true, false
+        // or null, and only the first one of each is kept.
+        auto scalar = ~(masks.op | masks.whitespace | masks.quote | inString);
+        auto scalarStart = scalar & ~((scalar << 1) | endsInScalar);
+        endsInScalar = scalar >> 63;
+
+        auto structural = (masks.op & ~inString) | (masks.quote & inString) | scalarStart;
+        while (structural)
+        {
+            positions.push_back(static_cast<std::uint32_t>(offset + __builtin_ctzll(structural)));
+            structural &= structural - 1;
+        }
+    }
+
+    if (strings.inString())
+        throw SyntaxError();
+}
+
+std::size_t skipValue(std::string_view input, std::size_t index)
+{
+    if (index == input.size())
+        throw SyntaxError();
+
+    auto ch = input[index];
+    if (ch == '"')
+    {
+        auto findStringSpecial = scanKernels().findStringSpecial;
+        for (index++;;)
+        {
+            index = findStringSpecial(input.data(), input.size(), index);
+            if (index >= input.size())
+                throw SyntaxError();
+            if (input[index] == '"')
+                return index + 1;
+            if (input[index] == '\\' && index + 1 >= input.size())
+                throw SyntaxError();
+            index += input[index] == '\\' ? 2 : 1;
+        }
+    }
+
+    if (ch != '{' && ch != '[')
+    {
+        // Only a number or a literal, which is at least one byte long.
+        if ((ch < '0' || ch > '9') && ch != '-' && ch != 't' && ch != 'f' && ch != 'n')
+            throw SyntaxError();
+        while (index != input.size() && !isWhitespace(input[index]) && !isStructuralOp(input[index]))
+            index++;
+        return index;
+    }
+
+    StringTracker strings;
+    // The closing bracket every open container expects, innermost last.
+    std::string closers;
+    for (auto offset = index; offset < input.size(); offset += 64)
+    {
+        BlockMasks masks;
+        classifyBlock(input, offset, masks);
+        auto ops = masks.op & ~strings.next(masks);
+        while (ops)
+        {
+            auto position = offset + __builtin_ctzll(ops);
+            ops &= ops - 1;
+
+            ch = input[position];
+            if (ch == '{')
+                closers.push_back('}');
+            else if (ch == '[')
+                closers.push_back(']');
+            else if (ch == '}' || ch == ']')
+            {
+                if (ch != closers.back())
+                    throw SyntaxError();
+                closers.pop_back();
+                if (closers.empty())
+                    return position + 1;
+            }
+        }
+    }
+    throw SyntaxError();
+}
+
+static std::uint64_t entry(char type, std::uint64_t payload)
+{
+    return (static_cast<std::uint64_t>(static_cast<unsigned char>(type)) << 56) | payload;
+}
+
+static char entryType(std::uint64_t word)
+{
+    return static_cast<char>(word >> 56);
+}
+
+static std::uint64_t entryPayload(std::uint64_t word)
+{
+    return word & ((std::uint64_t(1) << 56) - 1);
+}
+
+// A literal other than a string must be followed by a whitespace, a structural character
+// or the end of the input, e.g. `truex` or `12abc` are rejected.
+static void expectLiteralEnd(std::string_view input, size_type end)
+{
+    if (end != input.size() && !isWhitespace(input[end]) && !isStructuralOp(input[end]))
+        throw SyntaxError();
+}
+
+void Tape::appendString(std::string_view str)
+{
+    auto length = static_cast<std::uint32_t>(str.size());
+    tape.push_back(entry('"', strings.size()));
+    strings.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    strings.append(str);
+}
+
+/**
+ * @brief Parses `input` into the tape, walking the structural index with an explicit
+ * stack instead of recursing.
+ */
+void Tape::parse(std::string_view input)
+{
+    if (input.size() > UINT32_MAX)
+        throw std::length_error("The tape engine parses inputs of up to 4 GiB");
+
+    buildStructuralIndex(input, positions);
+    tape.clear();
+    strings.clear();
+
+    struct Scope
+    {
+        std::size_t start;
+        std::uint32_t count;
+        bool object;
+    };
+    std::vector<Scope> scopes;
+
+    std::size_t i = 0;
+    auto next = [&]()
+    {
+        if (i == positions.size())
+            throw SyntaxError();
+        return positions[i++];
+    };
+    auto close = [&]()
+    {
+        auto scope = scopes.back();
+        scopes.pop_back();
+
+        auto count = std::min<std::uint64_t>(scope.count, 0xFFFFFF);
+        tape[scope.start] = entry(scope.object ? '{' : '[', (count << 32) | tape.size());
+        tape.push_back(entry(scope.object ? '}' : ']', scope.start));
+    };
+
+    enum
+    {
+        Value,
+        Key,
+        AfterValue,
+    } state = Value;
+
+    while (true)
+    {
+        if (state == Value)
+        {
+            auto pos = next();
+            auto ch = input[pos];
+
+            if (!scopes.empty() && !scopes.back().object)
+                scopes.back().count++;
+
+            if (ch == '{' || ch == '[')
+            {
+                auto object = ch == '{';
+                scopes.push_back({tape.size(), 0, object});
+                tape.push_back(0);
+
+                if (i != positions.size() && input[positions[i]] == (object ? '}' : ']'))
+                {
+                    i++;
+                    close();
+                    state = AfterValue;
+                }
+                else
+                {
+                    state = object ? Key : Value;
+                }
+                continue;
+            }
+            else if (ch == '"')
+            {
+                std::string_view str;
+                parseStringLiteral(input, pos, buffer, nullptr, str);
+                appendString(str);
+            }
+            else if (ch == '-' || (ch >= '0' && ch <= '9'))
+            {
+                JSON value(nullptr);
+                expectLiteralEnd(input, parseNumberLiteral(input, pos, value));
+                std::uint64_t bits;
+                if (!value.isInteger())
+                {
+                    auto number = value.getNumber();
+                    std::memcpy(&bits, &number, sizeof(bits));
+                    tape.push_back(entry('d', 0));
+                }
+                else if (value.getNumber() < 0)
+                {
+                    bits = static_cast<std::uint64_t>(value.getInt64());
+                    tape.push_back(entry('l', 0));
+                }
+                else
+                {
+                    bits = value.getUint64();
+                    tape.push_back(entry('u', 0));
+                }
+                tape.push_back(bits);
+            }
+            else if (ch == 't')
+            {
+                expectLiteralEnd(input, expectString(input, pos, "true"));
+                tape.push_back(entry('t', 0));
+            }
+            else if (ch == 'f')
+            {
+                expectLiteralEnd(input, expectString(input, pos, "false"));
+                tape.push_back(entry('f', 0));
+            }
+            else if (ch == 'n')
+            {
+                expectLiteralEnd(input, expectString(input, pos, "null"));
+                tape.push_back(entry('n', 0));
+            }
+            else
+                throw SyntaxError();
+
+            state = AfterValue;
+        }
+        else if (state == Key)
+        {
+            auto pos = next();
+            if (input[pos] != '"')
+                throw SyntaxError();
+
+            std::string_view key;
+            parseStringLiteral(input, pos, buffer, nullptr, key);
+            appendString(key);
+            scopes.back().count++;
+
+            if (input[next()] != ':')
+                throw SyntaxError();
+            state = Value;
+        }
+        else
+        {
+            if (scopes.empty())
+            {
+                if (i != positions.size())
+                    throw SyntaxError();
+                return;
+            }
+
+            auto ch = input[next()];
+            if (ch == ',')
+                state = scopes.back().object ? Key : Value;
+            else if (ch == (scopes.back().object ? '}' : ']'))
+                close();
+            else
+                throw SyntaxError();
+        }
+    }
+}
+
+JSON Tape::toJSON(KeyPool *keys) const
+{
+    JSON result(nullptr);
+    if (!tape.empty())
+        build(0, result, keys);
+    return result;
+}
+
+// Builds the value at `index` into `out`, and returns the index of the entry after it.
+std::size_t Tape::build(std::size_t index, JSON &out, KeyPool *keys) const
+{
+    auto word = tape[index];
+    auto payload = entryPayload(word);
+
+    auto stringAt = [this](std::uint64_t offset)
+    {
+        std::uint32_t length;
+        std::memcpy(&length, strings.data() + offset, sizeof(length));
+        return std::string_view(strings.data() + offset + sizeof(length), length);
+    };
+
+    switch (entryType(word))
+    {
+    case '{':
+    {
+        auto end = static_cast<std::uint32_t>(payload);
+        auto &members = out.makeObject(nullptr);
+        for (index++; index != end;)
+        {
+            auto key = stringAt(entryPayload(tape[index]));
+            auto &member = (keys ? members.emplace(JSON::Key(key, *keys), nullptr) : members.emplace(key, nullptr)).first->second;
+            index = build(index + 1, member, keys);
+        }
+        return end + 1;
+    }
+    case '[':
+    {
+        auto end = static_cast<std::uint32_t>(payload);
+        auto &items = out.makeArray(nullptr);
+        items.reserve(payload >> 32);
+        for (index++; index != end;)
+        {
+            items.emplace_back(nullptr);
+            index = build(index, items.back(), keys);
+        }
+        return end + 1;
+    }
+    case '"':
+        out = JSON(stringAt(payload));
+        return index + 1;
+    case 'd':
+    {
+        double value;
+        std::memcpy(&value, &tape[index + 1], sizeof(value));
+        out = value;
+        return index + 2;
+    }
+    case 'l':
+        out = static_cast<long long>(tape[index + 1]);
+        return index + 2;
+    case 'u':
+        out = static_cast<unsigned long long>(tape[index + 1]);
+        return index + 2;
+    case 't':
+        out = true;
+        return index + 1;
+    case 'f':
+        out = false;
+        return index + 1;
+    default:
+        out = nullptr;
+        return index + 1;
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef CPP_JSON_TAPE
+#define CPP_JSON_TAPE
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cppjson.hpp"
+#include "scan.hpp"
+
+// Classifies the 64-byte block of `input` at `offset`, the last one is padded with
+// whitespaces.
+void classifyBlock(std::string_view input, std::size_t offset, BlockMasks &masks);
+
+/**
+ * @brief Follows the strings of an input from one 64-byte block to the next.
+ *
+ * `next()` takes the masks of the next block, removes the escaped double-quotes from
+ * `masks.quote`, and returns the mask of the bytes inside strings: from an opening
+ * double-quote up to, but not including, its closing one.
+ */
+class StringTracker
+{
+public:
+    std::uint64_t next(BlockMasks &masks);
+    bool inString() const { return endsInString != 0; }
+
+private:
+    std::uint64_t endsOddRun = 0;
+    std::uint64_t endsInString = 0;
+};
+
+/**
+ * @brief Stage one of the tape engine: finds the positions of the structural characters
+ * `{}[]:,`, of the double-quotes opening strings and of the first character of every other
+ * literal, skipping everything inside strings. The input is classified 64 bytes at a time
+ * with the vector kernels, the rest is bit arithmetic on the resulting masks.
+ *
+ * Throws `SyntaxError` if a string is left open.
+ */
+void buildStructuralIndex(std::string_view input, std::vector<std::uint32_t> &positions);
+
+/**
+ * @brief Returns the index right after the value starting at `index`, without decoding it.
+ * Containers are skipped 64 bytes at a time by matching their brackets outside strings,
+ * like `buildStructuralIndex()`, so only the structure of a skipped value is checked.
+ *
+ * Throws `SyntaxError` if no value starts at `index`, if the value isn't closed, or if a
+ * bracket closes a container of the other kind.
+ */
+std::size_t skipValue(std::string_view input, std::size_t index);
+
+/**
+ * @brief Stage two of the tape engine: a flat encoding of a parsed value.
+ *
+ * Every entry is a 64-bit word whose top byte is its type, a character as in the JSON
+ * text, and the rest its payload:
+ *
+ *  - `{` and `[` hold the index of their closing entry in the low 32 bits, and the number
+ *    of members or elements (saturated at 2^24 - 1) in the bits above.
+ *  - `}` and `]` hold the index of their opening entry.
+ *  - `"` holds the offset of the string in `strings`, where a 32-bit length precedes the
+ *    bytes. Object members are a `"` entry for the key followed by the value.
+ *  - `d`, `l` and `u` are numbers, the next entry holds the bits of the double, the int64
+ *    or the uint64.
+ *  - `t`, `f` and `n` are true, false and null.
+ *
+ * The buffers are kept between parses, so a tape can be reused without reallocating.
+ */
+class Tape
+{
+public:
+    void parse(std::string_view input);
+    // Builds the value, interning the object keys in `keys` if given.
+    JSON toJSON(KeyPool *keys = nullptr) const;
+
+    const std::vector<std::uint64_t> &entries() const { return tape; }
+
+private:
+    std::vector<std::uint32_t> positions;
+    std::vector<std::uint64_t> tape;
+    std::string strings;
+    std::string buffer;
+
+    void appendString(std::string_view str);
+    std::size_t build(std::size_t index, JSON &out, KeyPool *keys) const;
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "threadpool.hpp"
+
+ThreadPool::ThreadPool(std::size_t threads)
+{
+    threads = std::max<std::size_t>(threads, 1);
+    for (std::size_t i = 0; i < threads; i++)
+        queues.emplace_back(new Queue());
+    for (std::size_t i = 0; i < threads; i++)
+        workers.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+
+    for (auto &worker : workers)
+        worker.join();
+}
+
+std::size_t ThreadPool::defaultSize()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    // Spread the tasks over the deques, idle workers steal them if that was unfair.
+    auto &queue = *queues[nextQueue++ % queues.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+        queued++;
+    }
+
+    // Taking the lock makes sure a worker that has just seen no task is already waiting.
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeUp.notify_one();
+}
+
+bool ThreadPool::take(std::size_t self, std::function<void()> &task)
+{
+    for (std::size_t i = 0; i < queues.size(); i++)
+    {
+        auto &queue = *queues[(self + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+
+        if (i == 0)
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        else
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        queued--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(std::size_t self)
+{
+    std::function<void()> task;
+    while (true)
+    {
+        if (take(self, task))
+        {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this]()
+                    { return stopping || queued > 0; });
+        if (stopping && queued == 0)
+            return;
+    }
+}
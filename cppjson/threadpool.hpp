@@ -0,0 +1,56 @@
+#ifndef CPP_JSON_THREAD_POOL
+#define CPP_JSON_THREAD_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A fixed set of worker threads with one task deque each. A worker takes its own
+ * tasks from the front and, once it runs out, steals from the back of the others', so
+ * uneven tasks still keep every thread busy.
+ *
+ * The destructor runs the tasks still queued, then joins the workers.
+ */
+class ThreadPool
+{
+public:
+    explicit ThreadPool(std::size_t threads);
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    ~ThreadPool();
+
+    // Queues a task, which must not throw.
+    void submit(std::function<void()> task);
+    std::size_t size() const { return workers.size(); }
+
+    // The number of threads to use by default, at least one.
+    static std::size_t defaultSize();
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<std::size_t> queued{0};
+    std::atomic<std::size_t> nextQueue{0};
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+
+    void run(std::size_t self);
+    bool take(std::size_t self, std::function<void()> &task);
+};
+
+#endif
@@ -1,120 +1,292 @@
 #include "cppjson.hpp"
-#include <sstream>
-#include <iomanip>
+#include <charconv>
 #include <cmath>
-#include <ios>
+#include <cstdint>
+#include <cstring>
 
-std::string toString(const JSON &json);
-std::string escapeCharacters(const std::string &str);
-std::string toStringArray(const JSON &json);
+#include "scan.hpp"
 
-std::string toString(const JSON &json)
+// Enough for any int64, uint64 or double written by `formatNumber`, e.g.
+// -2.2250738585072014e-308 is 24 characters.
+constexpr std::size_t MaxNumberLength = 32;
+
+std::size_t formatNumber(const JSON &json, char *out);
+std::size_t estimateSize(const JSON &json);
+void writeValue(const JSON &json, std::string &out, const SerializeOptions &options);
+void writeEscaped(std::string_view str, std::string &out, bool escapeNonAscii);
+
+std::string toString(const JSON &json, const SerializeOptions &options)
+{
+    std::string out;
+
+    // A string at the top level is written without its double-quotes.
+    if (json.isString())
+    {
+        writeEscaped(json.getString(), out, options.escapeNonAscii);
+        return out;
+    }
+
+    serialize(json, out, options);
+    return out;
+}
+
+/**
+ * @brief Appends `json` to `out`. The whole value is written into `out` directly, after
+ * reserving the space it is estimated to take.
+ */
+void serialize(const JSON &json, std::string &out, const SerializeOptions &options)
+{
+    out.reserve(out.size() + estimateSize(json));
+    writeValue(json, out, options);
+}
+
+std::string_view Writer::write(const JSON &json)
+{
+    out.clear();
+    serialize(json, out, options);
+    return out;
+}
+
+/**
+ * @brief Estimates the length of `json` serialized, assuming strings have nothing to
+ * escape and numbers take their longest length.
+ */
+std::size_t estimateSize(const JSON &json)
+{
+    switch (json.type())
+    {
+    case JSON::Bool:
+        return 5;
+    case JSON::Null:
+        return 4;
+    case JSON::Number:
+        return json.isInteger() ? 20 : 24;
+    case JSON::String:
+        return json.getString().size() + 2;
+    case JSON::Array:
+    {
+        std::size_t size = 2;
+        for (auto &item : json.getArray())
+            size += estimateSize(item) + 1;
+        return size;
+    }
+    case JSON::Object:
+    {
+        std::size_t size = 2;
+        for (auto &member : json.getObject())
+            size += member.first.size() + 3 + estimateSize(member.second) + 1;
+        return size;
+    }
+    default:
+        return 0;
+    }
+}
+
+void writeValue(const JSON &json, std::string &out, const SerializeOptions &options)
 {
     switch (json.type())
     {
     case JSON::Bool:
-        return json.getBool() ? "true" : "false";
+        out += json.getBool() ? "true" : "false";
+        break;
     case JSON::String:
-        return escapeCharacters(json.getString());
+        out += '"';
+        writeEscaped(json.getString(), out, options.escapeNonAscii);
+        out += '"';
+        break;
     case JSON::Null:
-        return "null";
+        out += "null";
+        break;
     case JSON::Number:
     {
-        double val = json.getNumber();
-        if (std::isnan(val) || std::isinf(val))
-        {
-            return "null";
-        }
-        else
+        char buf[MaxNumberLength];
+        out.append(buf, formatNumber(json, buf));
+        break;
+    }
+    case JSON::Array:
+    {
+        out += '[';
+        auto first = true;
+        for (auto &item : json.getArray())
         {
-            std::ostringstream oss;
-            oss << val;
-            return oss.str();
+            if (!first)
+                out += ',';
+            first = false;
+            writeValue(item, out, options);
         }
+        out += ']';
+        break;
     }
-    case JSON::Array:
+    case JSON::Object:
     {
-        auto s = std::string("[");
-        auto &array = json.getArray();
-
-        for (auto it = array.begin(); it != array.end(); it++)
+        out += '{';
+        auto first = true;
+        for (auto &member : json.getObject())
         {
-            s += toString(*it);
-            if (it != array.end() - 1)
-                s += ',';
+            if (!first)
+                out += ',';
+            first = false;
+            out += '"';
+            writeEscaped(member.first, out, options.escapeNonAscii);
+            out += "\":";
+            writeValue(member.second, out, options);
         }
+        out += '}';
+        break;
+    }
+    default:
+        break;
+    }
+}
 
-        s += ']';
+/**
+ * @brief Writes a number to `out`, which must hold `MaxNumberLength` characters, and returns
+ * the count of characters written.
+ *
+ * Doubles are written with the fewest digits that parse back to the same value, using the
+ * shortest round-trip mode of `std::to_chars` (Ryu in the standard libraries), so the
+ * output doesn't depend on the locale either. Doubles holding an integer smaller than 2^53
+ * are written as an integer, without a fraction or an exponent. NaN and the infinities
+ * have no JSON representation and are written as null, like `JSON.stringify` does.
+ */
+std::size_t formatNumber(const JSON &json, char *out)
+{
+    std::to_chars_result result;
 
-        return s;
+    if (json.isInteger())
+    {
+        if (json.getNumber() < 0)
+            result = std::to_chars(out, out + MaxNumberLength, json.getInt64());
+        else
+            result = std::to_chars(out, out + MaxNumberLength, json.getUint64());
+        return result.ptr - out;
     }
-    case JSON::Object:
+
+    auto val = json.getNumber();
+    if (std::isnan(val) || std::isinf(val))
     {
-        auto s = std::string("{");
-        auto &object = json.getObject();
+        std::memcpy(out, "null", 4);
+        return 4;
+    }
 
-        for (auto it = object.begin(); it != object.end(); it++)
-        {
-            s += '"';
-            s += escapeCharacters(it->first);
-            s += "\":\"";
-            s+= toString(it->second);
-            s += '"';
-            if (it != std::prev(object.end()))
-                s += ',';
-        }
-        s += '}';
+    // -0 is left to `to_chars`, which keeps its sign.
+    if (std::abs(val) < 9007199254740992.0 && val == std::trunc(val) && !(val == 0 && std::signbit(val)))
+        result = std::to_chars(out, out + MaxNumberLength, static_cast<std::int64_t>(val));
+    else
+        result = std::to_chars(out, out + MaxNumberLength, val);
+    return result.ptr - out;
+}
+
+// Decodes the UTF-8 sequence at `index` and returns its length, or 0 if it isn't valid.
+// Encoded surrogates are accepted, since the parser produces them for unpaired \u escapes.
+static std::size_t decodeUTF8(std::string_view str, std::size_t index, char32_t &codepoint)
+{
+    auto byte = [&](std::size_t i)
+    { return static_cast<unsigned char>(str[index + i]); };
+    auto isContinuation = [&](std::size_t i)
+    { return index + i < str.size() && (byte(i) & 0xC0u) == 0x80u; };
 
-        return s;
+    auto lead = byte(0);
+    if (lead >= 0xC2u && lead <= 0xDFu && isContinuation(1))
+    {
+        codepoint = (lead & 0x1Fu) << 6 | (byte(1) & 0x3Fu);
+        return 2;
     }
-    default:
-        return "";
+    if (lead >= 0xE0u && lead <= 0xEFu && isContinuation(1) && isContinuation(2) && (lead != 0xE0u || byte(1) >= 0xA0u))
+    {
+        codepoint = (lead & 0x0Fu) << 12 | (byte(1) & 0x3Fu) << 6 | (byte(2) & 0x3Fu);
+        return 3;
     }
+    if (lead >= 0xF0u && lead <= 0xF4u && isContinuation(1) && isContinuation(2) && isContinuation(3) &&
+        (lead != 0xF0u || byte(1) >= 0x90u) && (lead != 0xF4u || byte(1) <= 0x8Fu))
+    {
+        codepoint = (lead & 0x07u) << 18 | (byte(1) & 0x3Fu) << 12 | (byte(2) & 0x3Fu) << 6 | (byte(3) & 0x3Fu);
+        return 4;
+    }
+    return 0;
+}
+
+static void writeUnicodeEscape(char16_t unit, std::string &out)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+
+    char buf[6] = {'\\', 'u', hexDigits[unit >> 12], hexDigits[(unit >> 8) & 0xF], hexDigits[(unit >> 4) & 0xF], hexDigits[unit & 0xF]};
+    out.append(buf, sizeof(buf));
 }
 
-std::string escapeCharacters(const std::string &str)
+/**
+ * @brief Appends `str` to `out` with the characters JSON requires escaping escaped: the
+ * double-quote, the backslash and the control characters. With `escapeNonAscii`, the other
+ * characters outside ASCII are written as \uXXXX escapes too, with a surrogate pair beyond
+ * the BMP, and invalid UTF-8 as U+FFFD.
+ *
+ * The runs between two characters to escape are found by a vectorized kernel and copied in
+ * one go.
+ */
+void writeEscaped(std::string_view str, std::string &out, bool escapeNonAscii)
 {
-    std::ostringstream oss;
-    for (auto it = str.cbegin(); it != str.cend(); it++)
+    auto find = escapeNonAscii ? scanKernels().findEscapeOrNonAscii : scanKernels().findStringSpecial;
+
+    std::size_t index = 0;
+    while (true)
     {
-        switch (*it)
+        auto next = find(str.data(), str.size(), index);
+        out.append(str.data() + index, next - index);
+        if (next == str.size())
+            return;
+
+        index = next + 1;
+        switch (str[next])
         {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
         case '\n':
-            oss << "\\n";
+            out += "\\n";
             break;
         case '\r':
-            oss << "\\r";
+            out += "\\r";
             break;
         case '\f':
-            oss << "\\f";
+            out += "\\f";
             break;
         case '\t':
-            oss << "\\t";
+            out += "\\t";
             break;
         case '\b':
-            oss << "\\b";
+            out += "\\b";
             break;
         default:
-            // The char type's signedness depends on the compiler and the platform, in ARM and PowerPC it is unsigned
-            // but it is signed in x86 and x64. We must cast it to unsigned char before comparing, otherwise if the
-            // value is larger than 127, the result will probably be wrong (if it is a signed char).
-            //
-            // Here the value is implicitly casted to unsigned since 0x20u is a unsigned integer literal, according to
-            // the specification, it one operand is unsigned, the other should be casted to unsigned too, before doing
-            // the comparison.
-            //
-            // 0x20u is the smallest representable Unicode value, which is a space. Characters smaller than it are control
-            // characters and should be escaped, this is browser's function `JSON.stringify(...)`;'s behaviour.
-            if (*it < 0x20u)
+            // The char type's signedness depends on the compiler and the platform, so the
+            // byte is compared as an unsigned char. Control characters below 0x20 without a
+            // short escape are written as \u00XX, this is `JSON.stringify(...)`'s behaviour.
+            auto ch = static_cast<unsigned char>(str[next]);
+            if (ch < 0x20u)
             {
-                oss << "\\u" << std::setfill('0') << std::setw(4) << std::hex << static_cast<unsigned long>(*it);
+                writeUnicodeEscape(ch, out);
+                break;
             }
+
+            char32_t codepoint;
+            auto length = decodeUTF8(str, next, codepoint);
+            if (length == 0)
+                codepoint = 0xFFFD;
             else
+                index = next + length;
+
+            if (codepoint >= 0x10000)
             {
-                oss << *it;
+                codepoint -= 0x10000;
+                writeUnicodeEscape(static_cast<char16_t>(0xD800 + (codepoint >> 10)), out);
+                writeUnicodeEscape(static_cast<char16_t>(0xDC00 + (codepoint & 0x3FF)), out);
+            }
+            else
+            {
+                writeUnicodeEscape(static_cast<char16_t>(codepoint), out);
             }
         }
     }
-
-    return oss.str();
-}
\ No newline at end of file
+}
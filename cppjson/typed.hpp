@@ -0,0 +1,292 @@
+#ifndef CPP_JSON_TYPED
+#define CPP_JSON_TYPED
+
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cppjson.hpp"
+#include "sax.hpp"
+#include "tape.hpp"
+
+// A struct member read from the object member `name`.
+template <typename Struct, typename Type>
+struct JSONField
+{
+    std::string_view name;
+    Type Struct::*member;
+};
+
+template <typename Struct, typename Type>
+constexpr JSONField<Struct, Type> jsonField(std::string_view name, Type Struct::*member)
+{
+    return {name, member};
+}
+
+/**
+ * @brief The mapping between the struct `T` and the members of a JSON object, which lets
+ * `parseInto()` read `T` directly.
+ *
+ * A specialization has a static `fields()` returning a tuple of `jsonField()`s, most simply
+ * written with `CPPJSON_FIELDS(Type, member...)` at namespace scope, which maps every member
+ * to the JSON member of the same name:
+ *
+ *     struct Point { double x, y; };
+ *     CPPJSON_FIELDS(Point, x, y)
+ */
+template <typename T>
+struct JSONFields;
+
+template <typename T, typename = void>
+struct HasJSONFields : std::false_type
+{
+};
+
+template <typename T>
+struct HasJSONFields<T, std::void_t<decltype(JSONFields<T>::fields())>> : std::true_type
+{
+};
+
+#define CPPJSON_FIELD(Type, member) jsonField(#member, &Type::member)
+
+#define CPPJSON_FIELDS_1(Type, a) CPPJSON_FIELD(Type, a)
+#define CPPJSON_FIELDS_2(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_1(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_3(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_2(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_4(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_3(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_5(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_4(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_6(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_5(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_7(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_6(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_8(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_7(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_9(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_8(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_10(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_9(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_11(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_10(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_12(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_11(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_13(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_12(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_14(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_13(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_15(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_14(Type, __VA_ARGS__)
+#define CPPJSON_FIELDS_16(Type, a, ...) CPPJSON_FIELD(Type, a), CPPJSON_FIELDS_15(Type, __VA_ARGS__)
+
+#define CPPJSON_FIELDS_PICK(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, name, ...) name
+
+#define CPPJSON_FIELDS_COUNT(...)                                                                                   \
+    CPPJSON_FIELDS_PICK(__VA_ARGS__, CPPJSON_FIELDS_16, CPPJSON_FIELDS_15, CPPJSON_FIELDS_14, CPPJSON_FIELDS_13,       \
+                        CPPJSON_FIELDS_12, CPPJSON_FIELDS_11, CPPJSON_FIELDS_10, CPPJSON_FIELDS_9, CPPJSON_FIELDS_8,   \
+                        CPPJSON_FIELDS_7, CPPJSON_FIELDS_6, CPPJSON_FIELDS_5, CPPJSON_FIELDS_4, CPPJSON_FIELDS_3,      \
+                        CPPJSON_FIELDS_2, CPPJSON_FIELDS_1)
+
+// Up to 16 members, more need a hand-written `JSONFields` specialization.
+#define CPPJSON_FIELDS(Type, ...)                                                        \
+    template <>                                                                          \
+    struct JSONFields<Type>                                                              \
+    {                                                                                    \
+        static constexpr auto fields()                                                   \
+        {                                                                                \
+            return std::make_tuple(CPPJSON_FIELDS_COUNT(__VA_ARGS__)(Type, __VA_ARGS__)); \
+        }                                                                                \
+    };
+
+namespace cppjson::detail
+{
+    // The reader behind `parseInto()`.
+    class TypedReader
+    {
+    public:
+        explicit TypedReader(std::string_view input) : input(input) {}
+
+        // Parses the whole input, which must hold exactly one value.
+        template <typename T>
+        void parse(T &value)
+        {
+            auto index = read(skipWhitespaces(input, 0), value);
+            if (skipWhitespaces(input, index) != input.size())
+                throw SyntaxError();
+        }
+
+    private:
+        std::string_view input;
+        std::string buffer;
+
+        char peek(size_type index) const
+        {
+            if (index == input.size())
+                throw SyntaxError();
+            return input[index];
+        }
+
+        // Every function reads the value starting at `index` and returns the index right after it.
+
+        size_type read(size_type index, bool &value)
+        {
+            auto ch = peek(index);
+            if (ch != 't' && ch != 'f')
+                throw std::logic_error("The type is not boolean");
+            value = ch == 't';
+            return expectString(input, index, value ? "true" : "false");
+        }
+
+        size_type read(size_type index, std::string &value)
+        {
+            if (peek(index) != '"')
+                throw std::logic_error("The type is not string");
+            std::string_view str;
+            index = parseStringLiteral(input, index, buffer, nullptr, str);
+            value.assign(str);
+            return index;
+        }
+
+        size_type read(size_type index, JSON &value)
+        {
+            auto end = skipValue(input, index);
+            value = ::parse(input.substr(index, end - index));
+            return end;
+        }
+
+        template <typename T>
+        size_type read(size_type index, std::optional<T> &value)
+        {
+            if (peek(index) == 'n')
+            {
+                value.reset();
+                return expectString(input, index, "null");
+            }
+            return read(index, value.emplace());
+        }
+
+        template <typename T, typename Allocator>
+        size_type read(size_type index, std::vector<T, Allocator> &value)
+        {
+            if (peek(index) != '[')
+                throw std::logic_error("The type is not array");
+
+            value.clear();
+            index = skipWhitespaces(input, index + 1);
+            if (peek(index) == ']')
+                return index + 1;
+
+            while (true)
+            {
+                // Read into a local rather than `emplace_back()`, which `std::vector<bool>`
+                // doesn't return a `bool &` from.
+                T element{};
+                index = skipWhitespaces(input, read(index, element));
+                value.push_back(std::move(element));
+                auto ch = peek(index);
+                if (ch == ']')
+                    return index + 1;
+                if (ch != ',')
+                    throw SyntaxError();
+                index = skipWhitespaces(input, index + 1);
+            }
+        }
+
+        template <typename T>
+        size_type read(size_type index, T &value)
+        {
+            if constexpr (std::is_arithmetic_v<T>)
+                return readNumber(index, value);
+            else
+            {
+                static_assert(HasJSONFields<T>::value, "The type needs a JSONFields specialization, see CPPJSON_FIELDS");
+                return readObject(index, value);
+            }
+        }
+
+        template <typename T>
+        size_type readNumber(size_type index, T &value)
+        {
+            auto ch = peek(index);
+            if ((ch < '0' || ch > '9') && ch != '-')
+                throw std::logic_error("The type is not number");
+
+            JSON number(nullptr);
+            index = parseNumberLiteral(input, index, number);
+            if constexpr (std::is_floating_point_v<T>)
+                value = static_cast<T>(number.getNumber());
+            else if constexpr (std::is_signed_v<T>)
+            {
+                auto integer = number.getInt64();
+                if (integer < std::numeric_limits<T>::min() || integer > std::numeric_limits<T>::max())
+                    throw std::out_of_range("The number is out of the field's range");
+                value = static_cast<T>(integer);
+            }
+            else
+            {
+                auto integer = number.getUint64();
+                if (integer > std::numeric_limits<T>::max())
+                    throw std::out_of_range("The number is out of the field's range");
+                value = static_cast<T>(integer);
+            }
+            return index;
+        }
+
+        template <typename T>
+        size_type readObject(size_type index, T &value)
+        {
+            if (peek(index) != '{')
+                throw std::logic_error("The type is not object");
+
+            index = skipWhitespaces(input, index + 1);
+            if (peek(index) == '}')
+                return index + 1;
+
+            while (true)
+            {
+                if (peek(index) != '"')
+                    throw SyntaxError();
+
+                // The key may live in the scratch buffer, so it is matched before its value is read.
+                std::string_view key;
+                index = parseStringLiteral(input, index, buffer, nullptr, key);
+                index = skipWhitespaces(input, expectString(input, skipWhitespaces(input, index), ":"));
+
+                bool found = false;
+                std::apply([&](const auto &...fields)
+                           { (void)((fields.name == key && (index = read(index, value.*fields.member), found = true)) || ...); },
+                           JSONFields<T>::fields());
+                if (!found)
+                    index = skipValue(input, index);
+
+                index = skipWhitespaces(input, index);
+                auto ch = peek(index);
+                if (ch == '}')
+                    return index + 1;
+                if (ch != ',')
+                    throw SyntaxError();
+                index = skipWhitespaces(input, index + 1);
+            }
+        }
+    };
+}
+
+/**
+ * @brief Parses JSON straight into C++ values, without building a `JSON` tree.
+ *
+ * Reads `bool`, arithmetic types, `std::string`, `std::optional<T>` (null or missing),
+ * `std::vector<T>`, `JSON` for free-form values, and structs with `JSONFields`. Object
+ * members are assigned as their keys are met, keys without a field are skipped like
+ * `skipValue()` does, and fields without a key keep their value.
+ *
+ * Throws `SyntaxError` for invalid JSON, `std::logic_error` for a value of the wrong type
+ * and `std::out_of_range` for a number the field can't hold.
+ */
+template <typename T>
+void parseInto(std::string_view input, T &value)
+{
+    cppjson::detail::TypedReader(input).parse(value);
+}
+
+template <typename T>
+T parseAs(std::string_view input)
+{
+    T value{};
+    parseInto(input, value);
+    return value;
+}
+
+#endif
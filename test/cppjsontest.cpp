@@ -1,8 +1,62 @@
 #include <gtest/gtest.h>
 #include "../cppjson/cppjson.hpp"
+#include "../cppjson/push.hpp"
+#include "../cppjson/sax.hpp"
+#include "../cppjson/scan.hpp"
+#include "../cppjson/typed.hpp"
 #include <string>
 #include <limits>
 #include <vector>
+#include <cstdlib>
+#include <new>
+#include <cmath>
+#include <clocale>
+#include <random>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <system_error>
+
+// Counts the heap allocations made by the test program, so the tests can check how many
+// allocations a parse performs. Some tests run threads, hence the atomic.
+static std::atomic<size_t> allocationCount{0};
+
+void *operator new(size_t size)
+{
+  allocationCount++;
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+  std::free(ptr);
+}
+
+void *operator new(size_t size, std::align_val_t align)
+{
+  allocationCount++;
+  auto alignment = static_cast<size_t>(align);
+  if (void *ptr = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept
+{
+  std::free(ptr);
+}
 
 // Demonstrate some basic assertions.
 TEST(CppJSONTests, TestType)
@@ -28,7 +82,85 @@ TEST(CppJSONTests, TestType)
   EXPECT_TRUE(val.size() == 0);
 }
 
-TEST(CppJSONTests, TestParsingObject)
+// The parsing tests run against every parsing engine, the parallel parser, and the push
+// parser fed with the input split at every byte offset.
+enum class TestEngine
+{
+  RecursiveDescent,
+  Tape,
+  Parallel,
+  Push,
+};
+
+class CppJSONParsingTests : public ::testing::TestWithParam<TestEngine>
+{
+protected:
+  JSON parse(std::string_view str)
+  {
+    switch (GetParam())
+    {
+    case TestEngine::Tape:
+      return ::parse(str, ParseOptions{ParseEngine::Tape});
+    case TestEngine::Parallel:
+      return ::parse(str, ParseOptions{ParseEngine::RecursiveDescent, 4});
+    case TestEngine::Push:
+      return parseSplit(str);
+    default:
+      return ::parse(str);
+    }
+  }
+
+  // Every split must give the same result, or all of them must fail.
+  static JSON parseSplit(std::string_view str)
+  {
+    JSON result(nullptr);
+    size_t failures = 0;
+
+    for (size_t split = 0; split <= str.size(); split++)
+    {
+      PushParser parser;
+      try
+      {
+        parser.feed(str.substr(0, split));
+        parser.feed(str.substr(split));
+        auto json = parser.finish();
+        if (split != failures)
+        {
+          EXPECT_EQ(toString(json), toString(result)) << "split at " << split;
+        }
+        result = std::move(json);
+      }
+      catch (const SyntaxError &)
+      {
+        failures++;
+      }
+    }
+
+    EXPECT_TRUE(failures == 0 || failures == str.size() + 1) << str;
+    if (failures)
+      throw SyntaxError();
+    return result;
+  }
+};
+
+INSTANTIATE_TEST_SUITE_P(Engines, CppJSONParsingTests,
+                         ::testing::Values(TestEngine::RecursiveDescent, TestEngine::Tape, TestEngine::Parallel, TestEngine::Push),
+                         [](const ::testing::TestParamInfo<TestEngine> &info)
+                         {
+                           switch (info.param)
+                           {
+                           case TestEngine::Tape:
+                             return "Tape";
+                           case TestEngine::Parallel:
+                             return "Parallel";
+                           case TestEngine::Push:
+                             return "Push";
+                           default:
+                             return "RecursiveDescent";
+                           }
+                         });
+
+TEST_P(CppJSONParsingTests, TestParsingObject)
 {
   auto result = parse(R"(
     {
@@ -76,7 +208,7 @@ TEST(CppJSONTests, TestParsingObject)
   EXPECT_THROW(parse("{ \"hello\": 3, }"), SyntaxError);
 }
 
-TEST(CppJSONTests, TestParsingArray)
+TEST_P(CppJSONParsingTests, TestParsingArray)
 {
   auto json = parse("[ null, 2, \"\", { \"hello\": true }]");
 
@@ -100,17 +232,28 @@ TEST(CppJSONTests, TestParsingArray)
   EXPECT_THROW(parse("[3,]"), SyntaxError);
   EXPECT_THROW(parse("[,,3,,,]"), SyntaxError);
   EXPECT_THROW(parse("3,3 ]"), SyntaxError);
+  EXPECT_THROW(parse("[1}"), SyntaxError);
+  EXPECT_THROW(parse("[}"), SyntaxError);
+  EXPECT_THROW(parse("[[1]}"), SyntaxError);
+  EXPECT_THROW(parse("[  false\n}"), SyntaxError);
+  EXPECT_THROW(parse("[{\"a\": [1}, 2]"), SyntaxError);
 }
 
-TEST(CppJSONTests, TestParsingNumber)
+TEST_P(CppJSONParsingTests, TestParsingNumber)
 {
   EXPECT_THROW(parse("0x3e"), SyntaxError);
   EXPECT_THROW(parse("0x3E"), SyntaxError);
   EXPECT_THROW(parse("0332"), SyntaxError);
 
-  // EXPECT_THROW(parse(".12345"), SyntaxError);
-  // EXPECT_THROW(parse("12345."), SyntaxError);
-  // EXPECT_THROW(parse("12345.E10"), SyntaxError);
+  EXPECT_THROW(parse(".12345"), SyntaxError);
+  EXPECT_THROW(parse("12345."), SyntaxError);
+  EXPECT_THROW(parse("12345.E10"), SyntaxError);
+  EXPECT_THROW(parse("-"), SyntaxError);
+  EXPECT_THROW(parse("-01"), SyntaxError);
+  EXPECT_THROW(parse("+1"), SyntaxError);
+  EXPECT_THROW(parse("1e"), SyntaxError);
+  EXPECT_THROW(parse("1e+"), SyntaxError);
+  EXPECT_THROW(parse("[1.5e3x]"), SyntaxError);
 
   EXPECT_EQ(parse("0").getNumber(), 0);
   EXPECT_EQ(parse("332.33").getNumber(), 332.33);
@@ -119,9 +262,27 @@ TEST(CppJSONTests, TestParsingNumber)
   EXPECT_EQ(parse("1.23E+1000").getNumber(), std::numeric_limits<double>::infinity());
   EXPECT_EQ(parse("1.23e-1000").getNumber(), 0);
   EXPECT_EQ(parse("-1.23e-1000").getNumber(), 0);
+  EXPECT_TRUE(std::signbit(parse("-1.23e-1000").getNumber()));
+  EXPECT_TRUE(std::signbit(parse("-0").getNumber()));
+
+  EXPECT_EQ(parse("-0.0e0").getNumber(), 0);
+  EXPECT_EQ(parse("1E5").getNumber(), 1e5);
+  EXPECT_EQ(parse("-12345678901234567890").getNumber(), -12345678901234567890.0);
+  EXPECT_EQ(parse("[0.5,-7]").getArray()[1].getNumber(), -7);
+
+  // Integers are stored exactly, including IDs beyond 2^53.
+  EXPECT_TRUE(parse("9007199254740993").isInteger());
+  EXPECT_EQ(parse("9007199254740993").getInt64(), 9007199254740993);
+  EXPECT_EQ(parse("-9223372036854775808").getInt64(), INT64_MIN);
+  EXPECT_EQ(parse("18446744073709551615").getUint64(), UINT64_MAX);
+  EXPECT_EQ(parse("[12345678901234567890]").getArray()[0].getUint64(), 12345678901234567890u);
+  EXPECT_FALSE(parse("18446744073709551616").isInteger());
+  EXPECT_FALSE(parse("-9223372036854775809").isInteger());
+  EXPECT_FALSE(parse("1.0").isInteger());
+  EXPECT_FALSE(parse("-0").isInteger());
 }
 
-TEST(CppJSONTests, TestParsingString)
+TEST_P(CppJSONParsingTests, TestParsingString)
 {
   EXPECT_EQ(parse(u8"\"\\uD83D\\uDE00\"").getString(), std::string(u8"😀"));
   EXPECT_EQ(parse(u8"\"\\u4f60\\u597d\"").getString(), std::string(u8"你好"));
@@ -136,9 +297,13 @@ TEST(CppJSONTests, TestParsingString)
   EXPECT_THROW(parse("\"\\s\""), SyntaxError);
   EXPECT_THROW(parse("\"(\\u8A)\""), SyntaxError);
   EXPECT_THROW(parse("\\U0020"), SyntaxError);
+
+  // A backslash at the very end of the input.
+  for (std::string truncated : {"\"\\", "\"abc\\", "[\"abc\\", "{\"a\\"})
+    EXPECT_THROW(parse(truncated), SyntaxError) << truncated;
 }
 
-TEST(CppJSONTests, TestParsingBoolean)
+TEST_P(CppJSONParsingTests, TestParsingBoolean)
 {
   EXPECT_EQ(parse("true").getBool(), true);
   EXPECT_EQ(parse("false").getBool(), false);
@@ -146,7 +311,7 @@ TEST(CppJSONTests, TestParsingBoolean)
   EXPECT_THROW(parse("ture"), SyntaxError);
 }
 
-TEST(CppJSONTests, TestParsingNull)
+TEST_P(CppJSONParsingTests, TestParsingNull)
 {
   EXPECT_TRUE(parse("null").isNull());
   EXPECT_EQ(parse("null").getNull(), nullptr);
@@ -167,6 +332,23 @@ TEST(CppJSONTests, TestToStringString)
 
   json = u8"你好\r\n😀\f\t\b\v\x02";
   EXPECT_EQ(toString(json), std::string(u8"你好\\r\\n😀\\f\\t\\b\\u000b\\u0002"));
+
+  json = R"(say "hi" C:\dir)";
+  EXPECT_EQ(toString(json), R"(say \"hi\" C:\\dir)");
+
+  // Non-ASCII characters are escaped on demand, with a surrogate pair beyond the BMP.
+  json = u8"é你好😀\x7f";
+  EXPECT_EQ(toString(json, SerializeOptions{true}), "\\u00e9\\u4f60\\u597d\\ud83d\\ude00\x7f");
+  EXPECT_EQ(toString(JSON("\xff\xc3")), "\xff\xc3");
+  EXPECT_EQ(toString(JSON("a\xff" "b\xc3"), SerializeOptions{true}), "a\\ufffdb\\ufffd");
+
+  // Long strings with characters to escape around the vector blocks round-trip.
+  for (auto i = 0; i < 80; i++)
+  {
+    auto str = std::string(i, 'a') + "\"\\\n" + u8"你" + std::string(80 - i, 'b') + "\x01";
+    EXPECT_EQ(parse(toString(std::vector<JSON>{str})).getArray()[0].getString(), str);
+    EXPECT_EQ(parse(toString(std::vector<JSON>{str}, SerializeOptions{true})).getArray()[0].getString(), str);
+  }
 }
 
 TEST(CppJSONTests, TestToStringNull)
@@ -217,6 +399,63 @@ TEST(CppJSONTests, TestToStringNumber)
     std::string strVal = toString(json);
     EXPECT_EQ(strVal, std::string("null"));
   }
+
+  // The shortest representation that parses back to the same double.
+  EXPECT_EQ(toString(JSON(0.1234567)), "0.1234567");
+  EXPECT_EQ(toString(JSON(0.1)), "0.1");
+  EXPECT_EQ(toString(JSON(1e100)), "1e+100");
+  EXPECT_EQ(toString(JSON(5e-324)), "5e-324");
+  EXPECT_EQ(toString(JSON(1.7976931348623157e308)), "1.7976931348623157e+308");
+  EXPECT_EQ(toString(JSON(-0.0)), "-0");
+
+  // Doubles holding an integer are written without an exponent.
+  EXPECT_EQ(toString(JSON(3.0)), "3");
+  EXPECT_EQ(toString(JSON(-1234567.0)), "-1234567");
+  EXPECT_EQ(toString(JSON(9007199254740991.0)), "9007199254740991");
+
+  std::mt19937_64 random(7);
+  for (auto i = 0; i < 10000; i++)
+  {
+    auto bits = random();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if (std::isnan(value) || std::isinf(value))
+      continue;
+
+    auto actual = parse(toString(JSON(value))).getNumber();
+    EXPECT_EQ(std::memcmp(&actual, &value, sizeof(double)), 0) << toString(JSON(value));
+  }
+}
+
+TEST(CppJSONTests, TestIntegers)
+{
+  JSON json = 42;
+  EXPECT_TRUE(json.isNumber());
+  EXPECT_TRUE(json.isInteger());
+  EXPECT_EQ(json.getNumber(), 42);
+  EXPECT_EQ(json.getInt64(), 42);
+  EXPECT_EQ(json.getUint64(), 42u);
+
+  json = -1L;
+  EXPECT_EQ(json.getInt64(), -1);
+  EXPECT_THROW(json.getUint64(), std::out_of_range);
+
+  json = UINT64_MAX;
+  EXPECT_EQ(json.getUint64(), UINT64_MAX);
+  EXPECT_THROW(json.getInt64(), std::out_of_range);
+
+  // Doubles holding an integer can be read as one.
+  json = 1e3;
+  EXPECT_FALSE(json.isInteger());
+  EXPECT_EQ(json.getInt64(), 1000);
+  EXPECT_THROW(JSON(1.5).getInt64(), std::out_of_range);
+  EXPECT_THROW(JSON(1e30).getUint64(), std::out_of_range);
+  EXPECT_THROW(JSON("1").getInt64(), std::logic_error);
+
+  EXPECT_EQ(toString(JSON(9007199254740993LL)), "9007199254740993");
+  EXPECT_EQ(toString(JSON(INT64_MIN)), "-9223372036854775808");
+  EXPECT_EQ(toString(JSON(UINT64_MAX)), "18446744073709551615");
+  EXPECT_EQ(toString(parse("[-12, 0, 123456789012345678]")), "[-12,0,123456789012345678]");
 }
 
 TEST(CppJSONTests, TestToStringArray)
@@ -259,4 +498,1040 @@ TEST(CppJSONTests, TestToStringObject)
   EXPECT_EQ(subobject["true"].getBool(), true);
   EXPECT_EQ(subobject["false"].getBool(), false);
   EXPECT_EQ(subobject.getObject().size(), 2);
-}
\ No newline at end of file
+}
+TEST(CppJSONTests, TestObjectMap)
+{
+  // Members keep their insertion order, below and above the size the hash index starts at.
+  for (auto count : {3, 9, 100})
+  {
+    JSON json;
+    auto &members = json.getObject();
+    for (auto i = count - 1; i >= 0; i--)
+      members.emplace("key" + std::to_string(i), i);
+
+    EXPECT_EQ(members.size(), static_cast<size_t>(count));
+    auto expected = count - 1;
+    for (auto &member : members)
+    {
+      EXPECT_EQ(std::string_view(member.first), "key" + std::to_string(expected));
+      EXPECT_EQ(member.second.getInt64(), expected);
+      expected--;
+    }
+    for (auto i = 0; i < count; i++)
+      EXPECT_EQ(members.at("key" + std::to_string(i)).getInt64(), i);
+    EXPECT_FALSE(members.contains("missing"));
+    EXPECT_THROW(members.at("missing"), std::out_of_range);
+
+    // Inserting an existing key keeps the member.
+    EXPECT_FALSE(members.emplace("key0", "other").second);
+    EXPECT_EQ(members.at("key0").getInt64(), 0);
+
+    // Erasing keeps the order of the others, and they are still found.
+    EXPECT_EQ(members.erase("key1"), 1u);
+    EXPECT_EQ(members.erase("key1"), 0u);
+    EXPECT_EQ(members.size(), static_cast<size_t>(count - 1));
+    EXPECT_EQ(std::string_view(members.begin()->first), "key" + std::to_string(count - 1));
+    for (auto i = 0; i < count; i++)
+      EXPECT_EQ(members.count("key" + std::to_string(i)), i == 1 ? 0u : 1u);
+
+    // Assigning a map to itself keeps it whole.
+    auto &self = members;
+    members = self;
+    EXPECT_EQ(members.size(), static_cast<size_t>(count - 1));
+    for (auto i = 2; i < count; i++)
+      EXPECT_EQ(members.at("key" + std::to_string(i)).getInt64(), i);
+  }
+
+  auto json = parse(R"({"z": 1, "a": 2, "m": {"y": [], "b": null}, "z": 3})");
+  EXPECT_EQ(toString(json), R"({"z":3,"a":2,"m":{"y":[],"b":null}})");
+}
+
+TEST(CppJSONTests, TestKeyPool)
+{
+  KeyPool pool;
+  ParseOptions options;
+  options.keys = &pool;
+
+  auto input = R"({"a_rather_long_key_name": 1, "short": {"another_long_key_name": [true]}})";
+  auto first = parse(input, options);
+  auto second = parse(input, ParseOptions{ParseEngine::Tape, 1, &pool});
+  EXPECT_EQ(toString(first), toString(parse(input)));
+  EXPECT_EQ(toString(second), toString(first));
+
+  // Long keys are shared across documents, short ones are inline.
+  auto &key = first.getObject().begin()->first;
+  EXPECT_TRUE(key.isInterned());
+  EXPECT_EQ(key.data(), second.getObject().begin()->first.data());
+  EXPECT_FALSE(first.getObject().find("short")->first.isInterned());
+
+  // The inline key "short" bypasses the pool, and isn't counted.
+  auto stats = pool.stats();
+  EXPECT_EQ(stats.keys, 2u);
+  EXPECT_EQ(stats.bytes, std::strlen("a_rather_long_key_name") + std::strlen("another_long_key_name"));
+  EXPECT_EQ(stats.lookups, 4u);
+  EXPECT_EQ(stats.hits, 2u);
+  EXPECT_DOUBLE_EQ(stats.hitRate(), 0.5);
+
+  // Copies share interned keys, and lookups by an interned key compare addresses.
+  JSON copy = first;
+  EXPECT_EQ(copy.getObject().begin()->first.data(), key.data());
+  EXPECT_EQ(copy.getObject().at(pool.intern("a_rather_long_key_name")).getInt64(), 1);
+  EXPECT_EQ(copy["short"]["another_long_key_name"][0].getBool(), true);
+
+  // The pool is shared by the threads of a parallel parse.
+  std::string lines;
+  for (auto i = 0; i < 200; i++)
+    lines += R"({"identifier_of_the_event": )" + std::to_string(i) + "}\n";
+  JSONLinesOptions linesOptions;
+  linesOptions.threads = 4;
+  linesOptions.batchSize = 8;
+  linesOptions.keys = &pool;
+  auto parsed = parseLines(lines, linesOptions);
+  ASSERT_EQ(parsed.size(), 200u);
+  EXPECT_EQ(parsed[199].value["identifier_of_the_event"].getInt64(), 199);
+  EXPECT_EQ(parsed[0].value.getObject().begin()->first.data(), parsed[199].value.getObject().begin()->first.data());
+  EXPECT_EQ(pool.stats().keys, 3u);
+  // The lookup by an interned key above was a hit too.
+  EXPECT_EQ(pool.stats().hits, 3u + 199u);
+}
+
+TEST(CppJSONTests, TestCompactLayout)
+{
+  EXPECT_EQ(sizeof(JSON), 16);
+
+  JSON shortString = "fourteen bytes";
+  JSON longString = "a string longer than the inline capacity";
+  EXPECT_EQ(shortString.getString(), "fourteen bytes");
+  EXPECT_EQ(longString.getString(), "a string longer than the inline capacity");
+
+  // Copies share the bytes of a long string.
+  JSON copy = longString;
+  EXPECT_EQ(copy.getString(), longString.getString());
+  EXPECT_EQ(copy.getString().data(), longString.getString().data());
+
+  JSON moved = std::move(copy);
+  EXPECT_EQ(moved.getString(), "a string longer than the inline capacity");
+  EXPECT_TRUE(copy.isNull());
+
+  swap(shortString, moved);
+  EXPECT_EQ(shortString.getString(), "a string longer than the inline capacity");
+  EXPECT_EQ(moved.getString(), "fourteen bytes");
+
+  JSON object;
+  object["missing"];
+  EXPECT_EQ(object.getObject().size(), 0);
+  object["present"] = longString;
+  EXPECT_EQ(object["present"].getString(), longString.getString());
+  EXPECT_EQ(object.getObject().size(), 1);
+}
+
+TEST(CppJSONTests, TestMissingMembers)
+{
+  auto json = parse(R"({"present": {"inner": 1}, "a key longer than fourteen bytes": true})");
+  std::string key = "a key longer than fourteen bytes";
+
+  // Looking up absent keys, by any kind of string, doesn't allocate.
+  size_t before = allocationCount;
+  EXPECT_EQ(json.find("missing"), nullptr);
+  EXPECT_EQ(json.find(std::string_view("missing")), nullptr);
+  EXPECT_FALSE(json["missing"].exists());
+  EXPECT_TRUE(json["missing"].isNull());
+  EXPECT_TRUE(json[key].getBool());
+  EXPECT_EQ(json["present"]["inner"].getInt64(), 1);
+  EXPECT_FALSE(json["present"]["missing"].exists());
+  EXPECT_EQ(allocationCount, before);
+  EXPECT_EQ(json.size(), 2u);
+
+  ASSERT_NE(json.find("present"), nullptr);
+  EXPECT_EQ(json.find("present")->find("inner")->getInt64(), 1);
+  const JSON &constJson = json;
+  EXPECT_EQ(constJson.find(key)->getBool(), true);
+
+  // Only an assignment inserts.
+  json["added"] = "value";
+  json["present"]["inner"] = 2;
+  json["copied"] = json["present"];
+  EXPECT_EQ(json.size(), 4u);
+  EXPECT_EQ(json["added"].getString(), "value");
+  EXPECT_EQ(json["copied"]["inner"].getInt64(), 2);
+
+  EXPECT_THROW(json["missing"].getString(), std::logic_error);
+  EXPECT_THROW(json["missing"]["deeper"].getArray(), std::logic_error);
+
+  // Assigning through missing members inserts them as objects.
+  json["a"]["b"]["c"] = 1;
+  EXPECT_EQ(toString(json["a"]), R"({"b":{"c":1}})");
+  json["a"]["d"] = true;
+  EXPECT_EQ(toString(json["a"]), R"({"b":{"c":1},"d":true})");
+  EXPECT_EQ(json.size(), 5u);
+  EXPECT_THROW(json["added"]["x"] = 1, std::logic_error);
+  json["list"] = std::vector<JSON>{};
+  EXPECT_THROW(json["list"][0] = 1, std::out_of_range);
+  EXPECT_THROW(JSON::array().find("key"), std::logic_error);
+}
+
+// Run under ThreadSanitizer with -DCPPJSON_SANITIZE_THREADS=ON.
+TEST(CppJSONTests, TestConcurrentReaders)
+{
+  const auto config = parse(R"({"service": {"name": "a name longer than fourteen bytes", "ports": [80, 443]},)"
+                            R"( "a": 1, "b": 2, "c": 3, "d": 4, "e": 5, "f": 6, "g": 7, "h": 8, "i": 9})");
+  const JSON copy = config;
+
+  EXPECT_EQ(config.at("a").getInt64(), 1);
+  EXPECT_EQ(config["service"]["ports"][1].getInt64(), 443);
+  EXPECT_TRUE(config["missing"].isNull());
+  EXPECT_TRUE(config.contains("i"));
+  EXPECT_FALSE(config.contains("missing"));
+  EXPECT_THROW(config.at("missing"), std::out_of_range);
+  EXPECT_THROW(config.at("service").at("ports").at(2), std::out_of_range);
+  EXPECT_THROW(config.at(0), std::logic_error);
+
+  std::vector<std::thread> readers;
+  std::vector<int64_t> sums(4, 0);
+  for (size_t t = 0; t < sums.size(); t++)
+    readers.emplace_back([&, t]()
+                         {
+                           for (auto round = 0; round < 500; round++)
+                           {
+                             // Both the value and a copy sharing its storage are read.
+                             auto &value = round % 2 ? config : copy;
+                             for (auto &member : value.getObject())
+                               if (member.second.isNumber())
+                                 sums[t] += member.second.getInt64();
+                             sums[t] += value.at("service").at("ports").at(0).getInt64();
+                             sums[t] += value["service"]["name"].getString().size();
+                             sums[t] += value.contains("missing");
+                             auto local = value;
+                             sums[t] += local.size();
+                           } });
+  for (auto &reader : readers)
+    reader.join();
+  for (auto sum : sums)
+    EXPECT_EQ(sum, 500 * (45 + 80 + 33 + 10));
+}
+
+TEST(CppJSONTests, TestJSONPointer)
+{
+  std::string input = R"({"user": {"id": 42, "name": "x"}, "items": [{"price": 1}, {"price": 2.5}, {"skipped": "[{\"]}"}, {"price": 4}],)"
+                      R"( "a/b": 1, "m~n": 2, "": 3, " ": 4, "big": {"k0": 0, "k1": 1, "k2": 2, "k3": 3, "k4": 4, "k5": 5, "k6": 6, "k7": 7, "k8": 8, "k9": 9}})";
+  auto json = parse(input);
+
+  std::vector<std::pair<std::string, std::string>> cases = {
+      {"", toString(json)},
+      {"/user/id", "42"},
+      {"/items/3/price", "4"},
+      {"/items/1", R"({"price":2.5})"},
+      // A top-level string is written without quotes.
+      {"/items/2/skipped", R"([{\"]})"},
+      {"/a~1b", "1"},
+      {"/m~0n", "2"},
+      {"/", "3"},
+      {"/ ", "4"},
+      {"/big/k9", "9"},
+  };
+  for (auto &test : cases)
+  {
+    JSONPointer pointer(test.first);
+    ASSERT_NE(pointer.find(json), nullptr) << test.first;
+    EXPECT_EQ(toString(*pointer.find(json)), test.second) << test.first;
+    auto extracted = pointer.extract(input);
+    ASSERT_TRUE(extracted.has_value()) << test.first;
+    EXPECT_EQ(toString(*extracted), test.second) << test.first;
+  }
+
+  for (auto missing : {"/missing", "/user/id/more", "/items/4", "/items/-", "/items/01", "/items/x", "/big/k10", "/user/name/0"})
+  {
+    JSONPointer pointer(missing);
+    EXPECT_EQ(pointer.find(json), nullptr) << missing;
+    EXPECT_FALSE(pointer.extract(input).has_value()) << missing;
+  }
+
+  JSONPointer pointer("/items/0/price");
+  EXPECT_EQ(pointer.size(), 3u);
+  EXPECT_EQ(pointer[1], "0");
+  *pointer.find(json) = 10;
+  EXPECT_EQ(json["items"][0]["price"].getInt64(), 10);
+
+  EXPECT_THROW(JSONPointer("user"), std::invalid_argument);
+  EXPECT_THROW(JSONPointer("/a~2"), std::invalid_argument);
+  EXPECT_THROW(JSONPointer("/a~"), std::invalid_argument);
+
+  // Only the text on the path is checked.
+  EXPECT_EQ(JSONPointer("/b").extract(R"({"a": [1, tru, "\q"], "b": true})")->getBool(), true);
+  EXPECT_THROW(JSONPointer("/b").extract(R"({"a": 1 "b": true})"), SyntaxError);
+  EXPECT_THROW(JSONPointer("/b").extract(R"({"a": "open)"), SyntaxError);
+  for (auto malformed : {R"({"a":,"b":1})", R"({"a": }, "b": 1})", R"({"a":[1},"b":1})", R"({"a":{"x":1],"b":1})",
+                         R"({"a": "\)", R"({"a": x, "b": 1})"})
+    EXPECT_THROW(JSONPointer("/b").extract(malformed), SyntaxError) << malformed;
+}
+
+TEST(CppJSONTests, TestProjection)
+{
+  std::string payload(4096, 'x');
+  std::string input = R"({"id": 7, "payload": ")" + payload + R"(", "user": {"name": "ann", "bio": "skipped", "tags": ["a", "b"]},)"
+                      R"( "items": [{"price": 1, "blob": [1, 2, {"x": "]"}]}, {"price": 2.5}, {"name": "no price"}], "extra": null})";
+
+  Projection projection{"id", "/user/name", "/user/tags", "/items/price", "/missing/path"};
+  ParseOptions options;
+  options.projection = &projection;
+
+  // The payload is never copied out of the input.
+  size_t before = allocationCount;
+  auto json = parse(input, options);
+  EXPECT_LT(allocationCount - before, 30u);
+  EXPECT_EQ(toString(json), R"({"id":7,"user":{"name":"ann","tags":["a","b"]},"items":[{"price":1},{"price":2.5},{}]})");
+
+  // A path that ends at a value keeps the paths below it.
+  projection.add("/user");
+  const JSON projected = parse(input, options), full = parse(input);
+  EXPECT_EQ(toString(projected["user"]), toString(full["user"]));
+
+  Projection all{""};
+  options.projection = &all;
+  EXPECT_EQ(toString(parse(input, options)), toString(parse(input)));
+
+  KeyPool pool;
+  Projection ids{"/items/price"};
+  ParseOptions pooled{ParseEngine::Tape, 1, &pool, &ids};
+  const JSON pooledJSON = parse(input, pooled);
+  EXPECT_EQ(pooledJSON["items"][1]["price"].getNumber(), 2.5);
+
+  // Skipped values are only checked for structure, kept ones fully.
+  options.projection = &ids;
+  EXPECT_EQ(toString(parse(R"({"items": [], "other": [1, tru, "\q"]})", options)), R"({"items":[]})");
+  EXPECT_EQ(toString(parse("42", options)), "42");
+  EXPECT_THROW(parse(R"({"items": [{"price": tru}]})", options), SyntaxError);
+  EXPECT_THROW(parse(R"({"other": [1, 2})", options), SyntaxError);
+  EXPECT_THROW(parse(R"({"items": []} 1)", options), SyntaxError);
+  EXPECT_THROW(parse(R"({"items" [])", options), SyntaxError);
+  EXPECT_THROW(parse(R"({"x":,"items":[]})", options), SyntaxError);
+  EXPECT_THROW(parse(R"({"x": }, "items": []})", options), SyntaxError);
+  EXPECT_THROW(parse(R"({"x":[1},"items":[]})", options), SyntaxError);
+  EXPECT_THROW(parse(R"({"x": "\)", options), SyntaxError);
+  EXPECT_THROW(Projection{"/a~2"}, std::invalid_argument);
+}
+
+struct TypedItem
+{
+  std::string name;
+  double price = 0;
+  std::optional<std::vector<std::string>> tags;
+};
+CPPJSON_FIELDS(TypedItem, name, price, tags)
+
+struct TypedOrder
+{
+  std::uint64_t id = 0;
+  bool paid = false;
+  std::int8_t priority = 0;
+  std::optional<std::string> note;
+  std::vector<TypedItem> items;
+  std::vector<bool> flags;
+  JSON extra;
+};
+CPPJSON_FIELDS(TypedOrder, id, paid, priority, note, items, flags, extra)
+
+TEST(CppJSONTests, TestTypedParse)
+{
+  std::string input = R"({"id": 18446744073709551615, "unknown": {"deep": [1, "}", {"x": null}]}, "paid": true,)"
+                      R"( "items": [{"name": "pen\u00e9", "price": 1.5, "tags": ["a", "b"]}, {"price": 2, "name": "ink", "tags": null}],)"
+                      R"( "priority": -3, "flags": [true, false, true], "extra": {"any": [1, 2]}})";
+  auto order = parseAs<TypedOrder>(input);
+  EXPECT_EQ(order.id, std::numeric_limits<std::uint64_t>::max());
+  EXPECT_TRUE(order.paid);
+  EXPECT_EQ(order.priority, -3);
+  EXPECT_FALSE(order.note.has_value());
+  ASSERT_EQ(order.items.size(), 2u);
+  EXPECT_EQ(order.items[0].name, "pen\xc3\xa9");
+  EXPECT_EQ(order.items[0].price, 1.5);
+  EXPECT_EQ(*order.items[0].tags, (std::vector<std::string>{"a", "b"}));
+  EXPECT_EQ(order.items[1].name, "ink");
+  EXPECT_EQ(order.items[1].price, 2);
+  EXPECT_FALSE(order.items[1].tags.has_value());
+  EXPECT_EQ(order.flags, (std::vector<bool>{true, false, true}));
+  EXPECT_EQ(toString(order.extra), R"({"any":[1,2]})");
+
+  // Only the fields themselves allocate, the skipped member and the keys don't.
+  TypedItem item;
+  item.name.reserve(32);
+  size_t before = allocationCount;
+  parseInto(R"({"ignored": {"a": [1, 2, 3], "b": "a string longer than the small string buffer"}, "name": "short", "price": 3})", item);
+  EXPECT_EQ(allocationCount, before);
+  EXPECT_EQ(item.name, "short");
+  EXPECT_EQ(item.price, 3);
+
+  EXPECT_EQ(parseAs<std::vector<int>>("[1, 2, 3]"), (std::vector<int>{1, 2, 3}));
+  EXPECT_EQ(parseAs<std::optional<int>>("null"), std::nullopt);
+  EXPECT_THROW(parseAs<TypedOrder>(R"({"priority": 300})"), std::out_of_range);
+  EXPECT_THROW(parseAs<TypedOrder>(R"({"paid": 1})"), std::logic_error);
+  EXPECT_THROW(parseAs<TypedOrder>(R"({"items": {}})"), std::logic_error);
+  EXPECT_THROW(parseAs<TypedOrder>(R"({"id": 1 "paid": true})"), SyntaxError);
+  EXPECT_THROW(parseAs<TypedOrder>(R"({"unknown": [1, 2})"), SyntaxError);
+  EXPECT_THROW(parseAs<TypedOrder>(R"({"unknown":,"id":1})"), SyntaxError);
+  EXPECT_THROW(parseAs<TypedOrder>(R"({"unknown": })"), SyntaxError);
+  EXPECT_THROW(parseAs<TypedOrder>(R"({"unknown":[1},"id":1})"), SyntaxError);
+  EXPECT_THROW(parseAs<TypedOrder>(R"({"unknown": "\)"), SyntaxError);
+  EXPECT_THROW(parseAs<TypedOrder>(R"({"id": 1} 2)"), SyntaxError);
+}
+
+TEST(CppJSONTests, TestCopyOnWrite)
+{
+  auto base = parse(R"({"server": {"host": "a host name longer than fourteen bytes", "ports": [80, 443]},)"
+                    R"( "limits": {"cpu": 4, "memory": 1024}, "tags": ["x", "y"]})");
+  auto expected = toString(base);
+
+  // Copies share the whole tree.
+  size_t before = allocationCount;
+  JSON copy = base;
+  JSON assigned(nullptr);
+  assigned = base;
+  EXPECT_EQ(allocationCount, before);
+  const JSON &constBase = base, &constCopy = copy;
+  EXPECT_EQ(&constCopy.getObject(), &constBase.getObject());
+
+  // Modifying a copy clones the path to the change only.
+  copy["server"]["ports"][1] = 8443;
+  EXPECT_EQ(toString(base), expected);
+  EXPECT_EQ(copy["server"]["ports"][1].getInt64(), 8443);
+  EXPECT_NE(&constCopy.getObject(), &constBase.getObject());
+  EXPECT_EQ(&constCopy.getObject().at("limits").getObject(), &constBase.getObject().at("limits").getObject());
+  EXPECT_EQ(constCopy.getObject().at("server").getObject().at("host").getString().data(),
+            constBase.getObject().at("server").getObject().at("host").getString().data());
+
+  assigned["tags"].getArray().push_back("z");
+  EXPECT_EQ(base["tags"].size(), 2u);
+  EXPECT_EQ(assigned["tags"].size(), 3u);
+
+  // Copies taken after a reference has been handed out don't see it modify the original.
+  auto list = parse("[1]");
+  auto &items = list.getArray();
+  JSON snapshot = list;
+  items.push_back(2);
+  EXPECT_EQ(toString(snapshot), "[1]");
+  EXPECT_EQ(toString(list), "[1,2]");
+
+  auto object = parse(R"({"a": 1})");
+  auto &member = object.getObject().at("a");
+  const JSON objectCopy = object;
+  member = 2;
+  EXPECT_EQ(objectCopy["a"].getInt64(), 1);
+  EXPECT_EQ(object["a"].getInt64(), 2);
+
+  // Reads through a non-const value keep it shared, and copying it free.
+  auto config = parse(R"({"timeout": 30, "server": {"ports": [80, 443]}})");
+  JSON worker = config;
+  before = allocationCount;
+  EXPECT_EQ(config["timeout"].getInt64(), 30);
+  EXPECT_EQ(config["server"]["ports"].size(), 2u);
+  EXPECT_FALSE(config["server"]["missing"]["deeper"].exists());
+  EXPECT_NE(worker.find("server"), nullptr);
+  JSON another = config;
+  EXPECT_EQ(allocationCount, before);
+  const JSON &constConfig = config, &constWorker = worker, &constAnother = another;
+  EXPECT_EQ(&constConfig.getObject(), &constWorker.getObject());
+  EXPECT_EQ(&constConfig.getObject(), &constAnother.getObject());
+
+  // Writing through the same accessors clones only the path to the change.
+  worker["server"]["ports"][0] = 8080;
+  EXPECT_EQ(config["server"]["ports"][0].getInt64(), 80);
+  EXPECT_EQ(constWorker["server"]["ports"][0].getInt64(), 8080);
+  EXPECT_EQ(&constConfig.getObject(), &constAnother.getObject());
+
+  // Copies of a document's tree own their storage, the document may go away first.
+  JSON detached(nullptr);
+  {
+    JSON::Document document;
+    detached = document.parse(expected);
+  }
+  EXPECT_EQ(toString(detached), expected);
+
+  // Copies of one base are modified from several threads at once.
+  std::vector<std::thread> threads;
+  std::vector<JSON> results(4, JSON(nullptr));
+  for (size_t i = 0; i < results.size(); i++)
+    threads.emplace_back([&base, &results, i]()
+                         {
+                           for (auto round = 0; round < 200; round++)
+                           {
+                             JSON mine = base;
+                             mine["limits"]["cpu"] = static_cast<int>(i);
+                             results[i] = mine;
+                           } });
+  for (auto &thread : threads)
+    thread.join();
+  EXPECT_EQ(toString(base), expected);
+  for (size_t i = 0; i < results.size(); i++)
+    EXPECT_EQ(results[i]["limits"]["cpu"].getInt64(), static_cast<int64_t>(i));
+}
+
+TEST(CppJSONTests, TestParsingAllocations)
+{
+  // A nested array costs its header and its storage, scalars are stored inline. If a
+  // subtree were copied into its parent the count would grow with the square of the depth.
+  const size_t depth = 64;
+  auto input = std::string(depth, '[') + "1" + std::string(depth, ']');
+
+  size_t before = allocationCount;
+  auto json = parse(input);
+  EXPECT_EQ(allocationCount - before, 2 * depth);
+
+  // An object costs its header and its member storage, which starts with room for four
+  // members and doubles. Short keys and strings are inline.
+  input = R"({ "a": 1, "b": true, "c": null, "d": "short", "e": {} })";
+  before = allocationCount;
+  json = parse(input);
+  EXPECT_EQ(allocationCount - before, 1 + 2 + 1);
+}
+
+TEST(CppJSONTests, TestDocument)
+{
+  std::string input = R"({
+    "id": 42,
+    "name": "a name longer than fourteen bytes",
+    "tags": ["first", "second", "a tag longer than fourteen bytes"],
+    "nested": { "flag": true, "nothing": null }
+  })";
+
+  JSON::Document document(4096);
+  auto &root = document.parse(input);
+
+  EXPECT_EQ(root.getObject().size(), 4);
+  EXPECT_EQ(root.getObject().at("id").getNumber(), 42);
+  EXPECT_EQ(root.getObject().at("name").getString(), "a name longer than fourteen bytes");
+  EXPECT_EQ(root.getObject().at("tags").getArray()[2].getString(), "a tag longer than fourteen bytes");
+  EXPECT_TRUE(root.getObject().at("nested").getObject().at("nothing").isNull());
+
+  // A copy owns its storage and outlives the document's content.
+  JSON copy = root;
+  document.reset();
+  EXPECT_TRUE(document.root().isNull());
+  EXPECT_EQ(copy["name"].getString(), "a name longer than fourteen bytes");
+  EXPECT_EQ(toString(copy), toString(parse(input)));
+
+  // Once the decoding buffer has grown, a document that fits in the initial block is
+  // parsed and freed without touching the heap.
+  size_t before = allocationCount;
+  document.parse(input);
+  document.reset();
+  document.parse(input);
+  EXPECT_EQ(allocationCount - before, 0);
+  EXPECT_EQ(document.root().getObject().at("tags").getArray().size(), 3);
+
+  EXPECT_THROW(document.parse("[1, 2"), SyntaxError);
+}
+
+TEST(CppJSONTests, TestParsingRawBuffer)
+{
+  // The buffer isn't NUL-terminated after the value.
+  const char buffer[] = {'[', '1', '2', ',', '"', 'a', '"', ']', '3', '4'};
+  auto json = parse(buffer, 8);
+  EXPECT_EQ(json[0].getNumber(), 12);
+  EXPECT_EQ(json[1].getString(), "a");
+
+  EXPECT_EQ(parse(std::string_view("3.5e2 trailing", 5)).getNumber(), 350);
+  EXPECT_THROW(parse(buffer, 7), SyntaxError);
+
+  EXPECT_EQ(parse(R"("say \"hi\"")").getString(), "say \"hi\"");
+
+  // Strings without escapes are copied once, straight from the input.
+  size_t before = allocationCount;
+  json = parse(R"("a string longer than fourteen bytes")");
+  EXPECT_EQ(allocationCount - before, 1);
+}
+
+TEST(CppJSONTests, TestParsingInSitu)
+{
+  std::string input = R"(["a string longer than fourteen bytes", "tab\there, 你好 \"quoted\"", "short"])";
+
+  std::string numbers = "[1, 2, 3]";
+  size_t before = allocationCount;
+  parseInSitu(&numbers[0], numbers.size());
+  auto arrayAllocations = allocationCount - before;
+
+  // Only the array itself is allocated, every string is a view into the buffer.
+  before = allocationCount;
+  auto json = parseInSitu(&input[0], input.size());
+  EXPECT_EQ(allocationCount - before, arrayAllocations);
+
+  auto &array = json.getArray();
+  EXPECT_EQ(array[0].getString(), "a string longer than fourteen bytes");
+  EXPECT_EQ(array[1].getString(), std::string(u8"tab\there, 你好 \"quoted\""));
+  EXPECT_EQ(array[2].getString(), "short");
+  EXPECT_GE(array[0].getString().data(), input.data());
+  EXPECT_LT(array[0].getString().data(), input.data() + input.size());
+  EXPECT_GE(array[1].getString().data(), input.data());
+  EXPECT_LT(array[1].getString().data(), input.data() + input.size());
+
+  // A copy owns its strings.
+  JSON copy = json;
+  input.assign(input.size(), ' ');
+  EXPECT_EQ(copy[1].getString(), std::string(u8"tab\there, 你好 \"quoted\""));
+
+  std::string invalid = R"(["\x"])";
+  EXPECT_THROW(parseInSitu(&invalid[0], invalid.size()), SyntaxError);
+  for (std::string truncated : {"\"\\", "\"abc\\"})
+    EXPECT_THROW(parseInSitu(&truncated[0], truncated.size()), SyntaxError) << truncated;
+}
+
+TEST(CppJSONTests, TestScanKernels)
+{
+  auto &kernels = availableScanKernels();
+  ASSERT_GE(kernels.size(), 1);
+  EXPECT_EQ(std::string(kernels[0].name), "scalar");
+
+  // Inputs longer than a vector block, with the interesting bytes at every position.
+  std::vector<std::string> inputs = {
+      std::string(100, ' '),
+      std::string(100, 'a'),
+      std::string(40, ' ') + "\t\r\n" + std::string(40, ' ') + "x",
+      std::string(70, '\n') + "{",
+      std::string(33, 'a') + "\"" + std::string(33, 'b'),
+      std::string(50, 'a') + "\\n" + std::string(17, 'b'),
+      std::string(20, 'a') + "\x1f" + std::string(40, 'b') + "\x7f\x80\xff",
+      std::string(31, 'a') + "\x01",
+      u8"你好, 世界! this string is long enough for a vector block \"",
+  };
+  for (auto i = 0; i < 64; i++)
+  {
+    std::string input(i, ' ');
+    input += (i % 3 == 0) ? '"' : (i % 3 == 1) ? '\\' : '\x02';
+    input += std::string(64 - i, 'z');
+    inputs.push_back(input);
+  }
+
+  for (auto &input : inputs)
+  {
+    for (size_t index = 0; index <= input.size(); index++)
+    {
+      auto whitespace = kernels[0].skipWhitespace(input.data(), input.size(), index);
+      auto special = kernels[0].findStringSpecial(input.data(), input.size(), index);
+      auto escape = kernels[0].findEscapeOrNonAscii(input.data(), input.size(), index);
+
+      for (auto &kernel : kernels)
+      {
+        EXPECT_EQ(kernel.skipWhitespace(input.data(), input.size(), index), whitespace) << kernel.name;
+        EXPECT_EQ(kernel.findStringSpecial(input.data(), input.size(), index), special) << kernel.name;
+        EXPECT_EQ(kernel.findEscapeOrNonAscii(input.data(), input.size(), index), escape) << kernel.name;
+      }
+    }
+
+    for (size_t offset = 0; offset + 64 <= input.size(); offset++)
+    {
+      BlockMasks expected;
+      kernels[0].classify(input.data() + offset, expected);
+      for (auto &kernel : kernels)
+      {
+        BlockMasks masks;
+        kernel.classify(input.data() + offset, masks);
+        EXPECT_EQ(masks.whitespace, expected.whitespace) << kernel.name;
+        EXPECT_EQ(masks.op, expected.op) << kernel.name;
+        EXPECT_EQ(masks.quote, expected.quote) << kernel.name;
+        EXPECT_EQ(masks.backslash, expected.backslash) << kernel.name;
+      }
+    }
+  }
+
+  EXPECT_EQ(parse("  \n\t [ \n  1 ,\n        2 ]\n    ").getArray().size(), 2);
+  EXPECT_THROW(parse("\"raw\tcontrol\""), SyntaxError);
+}
+
+TEST(CppJSONTests, TestTapeBlockBoundaries)
+{
+  // Backslash runs and quotes at every position around the 64-byte blocks the structural
+  // index is built from, the engines must agree on all of them.
+  for (auto width = 50; width < 140; width++)
+  {
+    for (auto run = 0; run < 5; run++)
+    {
+      std::string input = "[\"" + std::string(width, 'a') + std::string(2 * run, '\\') + "\"";
+      input += ", \"" + std::string(width % 7, 'b') + "\\\"" + std::string(run, 'c') + "\", [1, -2.5e3, true, {\"k\": null}]]";
+
+      auto expected = parse(input);
+      auto actual = parse(input, ParseOptions{ParseEngine::Tape});
+      EXPECT_EQ(toString(actual), toString(expected)) << input;
+
+      // An odd run escapes the closing quote, which leaves the string open.
+      auto open = "[\"" + std::string(width, 'a') + std::string(2 * run + 1, '\\') + "\"]";
+      EXPECT_THROW(parse(open, ParseOptions{ParseEngine::Tape}), SyntaxError) << open;
+    }
+  }
+
+  EXPECT_THROW(parse("[truex]", ParseOptions{ParseEngine::Tape}), SyntaxError);
+  EXPECT_THROW(parse("[1 2]", ParseOptions{ParseEngine::Tape}), SyntaxError);
+  EXPECT_THROW(parse("{\"a\" 1}", ParseOptions{ParseEngine::Tape}), SyntaxError);
+  EXPECT_THROW(parse("", ParseOptions{ParseEngine::Tape}), SyntaxError);
+}
+
+TEST(CppJSONTests, TestNumberConversion)
+{
+  // Cases for every conversion method: integers, exact powers, halfway points, more than
+  // 19 significant digits, subnormals and the limits of the double range.
+  std::vector<std::string> inputs = {
+      "0", "-0", "1", "9007199254740993", "18446744073709551615", "18446744073709551616",
+      "0.1", "0.3", "3.14159265358979323846", "1e22", "1e23", "8.98846567431158e307",
+      "1.7976931348623157e308", "1.7976931348623159e308", "2.2250738585072011e-308",
+      "2.2250738585072014e-308", "4.9406564584124654e-324", "2.4703282292062327e-324",
+      "2.4703282292062328e-324", "9007199254740992.5", "9007199254740993.0000000000000000001",
+      "7.3177701707893310e+15", "2.2204460492503131e-16", "123456789012345678901234567890",
+      "0.000000000000000000000000000000000000000000001234", "1e-400", "1e400", "-1e-320",
+      "1.00000000000000011102230246251565404236316680908203125",
+      "1.00000000000000011102230246251565404236316680908203124",
+      "1.00000000000000011102230246251565404236316680908203126",
+  };
+
+  std::mt19937_64 random(42);
+  for (auto i = 0; i < 2000; i++)
+  {
+    inputs.push_back(std::to_string(random() % 100000000000) + "." + std::to_string(random() % 1000000) +
+                     "e" + std::to_string(static_cast<int>(random() % 700) - 350));
+    inputs.push_back(std::to_string(random()) + "e-" + std::to_string(random() % 40));
+  }
+
+  for (auto &input : inputs)
+  {
+    auto expected = std::strtod(input.c_str(), nullptr);
+    auto actual = parse(input).getNumber();
+    EXPECT_EQ(std::memcmp(&actual, &expected, sizeof(double)), 0) << input;
+  }
+
+  // The decimal point doesn't depend on the locale, a German one has a comma.
+  if (std::setlocale(LC_NUMERIC, "de_DE.UTF-8"))
+  {
+    EXPECT_EQ(parse("3.25").getNumber(), 3.25);
+    std::setlocale(LC_NUMERIC, "C");
+  }
+}
+
+TEST(CppJSONTests, TestWriter)
+{
+  auto json = parse(R"({"id": 12345678901234, "name": "cppjson", "tags": ["a", "b\nc"], "score": 0.5, "ok": true, "none": null})");
+  auto expected = R"({"id":12345678901234,"name":"cppjson","tags":["a","b\nc"],"score":0.5,"ok":true,"none":null})";
+
+  std::string out = "prefix ";
+  serialize(json, out);
+  EXPECT_EQ(out, std::string("prefix ") + expected);
+
+  Writer writer;
+  EXPECT_EQ(writer.write(json), expected);
+
+  // Once the buffer has grown, writing again doesn't allocate.
+  size_t before = allocationCount;
+  for (auto i = 0; i < 10; i++)
+    EXPECT_EQ(writer.write(json), expected);
+  EXPECT_EQ(allocationCount, before);
+
+  EXPECT_EQ(writer.write(JSON("str")), "\"str\"");
+  EXPECT_EQ(writer.output(), "\"str\"");
+
+  // toString leaves the double-quotes of a top-level string out, and only those.
+  EXPECT_EQ(toString(JSON("a\"b")), R"(a\"b)");
+  EXPECT_EQ(writer.write(JSON("a\"b")), R"("a\"b")");
+  EXPECT_EQ(toString(JSON(std::vector<JSON>{"a\"b"})), R"(["a\"b"])");
+}
+
+// Writes the events it receives as a compact text.
+struct RecordingHandler
+{
+  std::string events;
+
+  void onNull() { events += "null "; }
+  void onBool(bool value) { events += value ? "true " : "false "; }
+  void onNumber(const JSON &value) { events += toString(value) + ' '; }
+  void onString(std::string_view value) { events += "s:" + std::string(value) + ' '; }
+  void onKey(std::string_view key) { events += "k:" + std::string(key) + ' '; }
+  void onStartObject() { events += "{ "; }
+  void onEndObject() { events += "} "; }
+  void onStartArray() { events += "[ "; }
+  void onEndArray() { events += "] "; }
+};
+
+// Sums the numbers of a given key without keeping anything.
+struct SumHandler
+{
+  std::string_view wanted;
+  bool inWanted = false;
+  double sum = 0;
+  size_t count = 0;
+
+  void onNull() { inWanted = false; }
+  void onBool(bool) { inWanted = false; }
+  void onNumber(const JSON &value)
+  {
+    if (inWanted)
+    {
+      sum += value.getNumber();
+      count++;
+    }
+    inWanted = false;
+  }
+  void onString(std::string_view) { inWanted = false; }
+  void onKey(std::string_view key) { inWanted = key == wanted; }
+  void onStartObject() { inWanted = false; }
+  void onEndObject() {}
+  void onStartArray() { inWanted = false; }
+  void onEndArray() {}
+};
+
+TEST(CppJSONTests, TestSaxEvents)
+{
+  RecordingHandler recorder;
+  parseEvents(R"( {"a": [1, -2.5, true, null], "b\u00e9": {"c": "d\n"}, "e": []} )", recorder);
+  EXPECT_EQ(recorder.events, u8"{ k:a [ 1 -2.5 true null ] k:bé { k:c s:d\n } k:e [ ] } ");
+
+  recorder.events.clear();
+  EXPECT_THROW(parseEvents("[1, 2", recorder), SyntaxError);
+  EXPECT_THROW(parseEvents("", recorder), SyntaxError);
+  EXPECT_THROW(parseEvents("{\"a\" 1}", recorder), SyntaxError);
+  EXPECT_THROW(parseEvents("[1] 2", recorder), SyntaxError);
+
+  // Without escape sequences, reading the events doesn't allocate.
+  std::string input = "[";
+  for (auto i = 0; i < 100; i++)
+    input += R"({"id": )" + std::to_string(i) + R"(, "name": "a name longer than fourteen bytes", "price": 1.5, "tags": ["x", "y"]},)";
+  input.back() = ']';
+
+  SumHandler summer;
+  summer.wanted = "price";
+  size_t before = allocationCount;
+  parseEvents(input, summer);
+  EXPECT_EQ(allocationCount, before);
+  EXPECT_EQ(summer.count, 100);
+  EXPECT_EQ(summer.sum, 150);
+}
+
+TEST(CppJSONTests, TestPushParser)
+{
+  std::string input = R"({"id": 12345678901234567890, "text": "caf\u00e9 \ud83d\ude00 \"q\" \\", "list": [true, false, null, -1.5e-3, []], "o": {}})";
+  auto expected = toString(parse(input));
+
+  // Byte by byte, and in chunks of every size.
+  for (size_t size = 1; size <= input.size(); size++)
+  {
+    PushParser parser;
+    for (size_t i = 0; i < input.size(); i += size)
+      parser.feed(input.data() + i, std::min(size, input.size() - i));
+    EXPECT_EQ(toString(parser.finish()), expected) << size;
+  }
+
+  // The parser can be reused, and a number at the end is only complete at finish().
+  PushParser parser;
+  parser.feed("12");
+  parser.feed("34");
+  EXPECT_EQ(parser.finish().getInt64(), 1234);
+  parser.feed(" [1,");
+  EXPECT_THROW(parser.finish(), SyntaxError);
+
+  // A failed input doesn't affect the next one.
+  parser.feed("2");
+  EXPECT_EQ(parser.finish().getInt64(), 2);
+  EXPECT_THROW(parser.feed("[1}"), SyntaxError);
+  parser.reset();
+  parser.feed("[3]");
+  EXPECT_EQ(toString(parser.finish()), "[3]");
+
+  // The events come as soon as their chunk is fed.
+  RecordingHandler recorder;
+  PushReader<RecordingHandler> reader(recorder);
+  reader.feed(R"([ "ab)");
+  EXPECT_EQ(recorder.events, "[ ");
+  reader.feed(R"(c", tr)");
+  EXPECT_EQ(recorder.events, "[ s:abc ");
+  reader.feed("ue ]");
+  EXPECT_EQ(recorder.events, "[ s:abc true ] ");
+  reader.finish();
+}
+
+TEST(CppJSONTests, TestJSONLines)
+{
+  std::string input;
+  for (auto i = 1; i <= 1000; i++)
+  {
+    if (i % 100 == 0)
+      input += "{\"broken\": }\n";
+    else if (i % 250 == 1)
+      input += "  \r\n";
+    else
+      input += R"({"line": )" + std::to_string(i) + R"(, "text": "x"})" + "\r\n";
+  }
+  input += R"({"line": "last, without a newline"})";
+
+  for (size_t batchSize : {1, 7, 256, 5000})
+  {
+    JSONLinesOptions options;
+    options.threads = 4;
+    options.batchSize = batchSize;
+    auto lines = parseLines(input, options);
+
+    // The blank lines are skipped, the broken ones reported in order.
+    ASSERT_EQ(lines.size(), 1001 - 4);
+    size_t errors = 0;
+    size_t previous = 0;
+    for (auto &line : lines)
+    {
+      EXPECT_GT(line.lineNumber, previous);
+      previous = line.lineNumber;
+      if (line.lineNumber == 1001)
+        EXPECT_EQ(line.value["line"].getString(), "last, without a newline");
+      else if (line.lineNumber % 100 == 0)
+      {
+        EXPECT_FALSE(line.ok());
+        errors++;
+      }
+      else
+      {
+        ASSERT_TRUE(line.ok()) << line.lineNumber << ": " << line.error;
+        EXPECT_EQ(line.value["line"].getInt64(), static_cast<int64_t>(line.lineNumber));
+      }
+    }
+    EXPECT_EQ(errors, 10);
+  }
+
+  // The callback runs on the calling thread, in order.
+  auto caller = std::this_thread::get_id();
+  size_t count = 0;
+  size_t previous = 0;
+  parseLines("1\n2\n\n3\n", [&](JSONLine &line)
+             {
+               EXPECT_EQ(std::this_thread::get_id(), caller);
+               EXPECT_GT(line.lineNumber, previous);
+               previous = line.lineNumber;
+               count++; });
+  EXPECT_EQ(count, 3);
+  EXPECT_EQ(previous, 4);
+  EXPECT_TRUE(parseLines("").empty());
+}
+
+TEST(CppJSONTests, TestParallelArray)
+{
+  // Elements with strings holding commas, brackets and escaped quotes, of uneven sizes.
+  std::string input = " [";
+  for (auto i = 0; i < 5000; i++)
+  {
+    if (i)
+      input += i % 3 ? "," : " ,\n";
+    if (i % 4 == 0)
+      input += R"({"id": )" + std::to_string(i) + R"(, "s": "a, [b] {c} \"d,\" \\", "n": [[1, 2], {"x": [3]}]})";
+    else if (i % 4 == 1)
+      input += std::to_string(i) + ".5";
+    else if (i % 4 == 2)
+      input += R"("\\\\,\\")";
+    else
+      input += std::string(i % 97, ' ') + "[\"]\", []]";
+  }
+  input += "] ";
+
+  auto expected = toString(parse(input));
+  for (size_t threads : {2, 3, 8, 0})
+    EXPECT_EQ(toString(parse(input, ParseOptions{ParseEngine::RecursiveDescent, threads})), expected) << threads;
+
+  ParseOptions options{ParseEngine::RecursiveDescent, 4};
+  EXPECT_EQ(parse(" [ ] ", options).getArray().size(), 0);
+  EXPECT_EQ(parse("[[]]", options).getArray().size(), 1);
+  EXPECT_EQ(parse(R"({"a": [1, 2]})", options)["a"].getArray().size(), 2);
+  EXPECT_THROW(parse("[1, , 2]", options), SyntaxError);
+  EXPECT_THROW(parse("[1, 2,]", options), SyntaxError);
+  EXPECT_THROW(parse("[{]}", options), SyntaxError);
+  EXPECT_THROW(parse("[1, \"2]", options), SyntaxError);
+  EXPECT_THROW(parse("[1, 2] 3", options), SyntaxError);
+  EXPECT_THROW(parse(input.substr(0, input.size() - 2), options), SyntaxError);
+}
+
+TEST(CppJSONTests, TestParseFile)
+{
+  auto path = ::testing::TempDir() + "cppjson_test_parse_file.json";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << R"({"name": "a name longer than fourteen bytes", "escaped": "line\nbreak, and long enough", "n": [1, 2.5]})";
+  }
+
+  auto json = parseFile(path);
+  EXPECT_EQ(json["name"].getString(), "a name longer than fourteen bytes");
+  EXPECT_EQ(json["n"].getArray()[1].getNumber(), 2.5);
+
+  {
+    JSON::MappedDocument document(path);
+    auto &root = document.root();
+    auto bytes = document.bytes();
+    EXPECT_EQ(toString(root), toString(json));
+
+    // Strings without escapes are views into the mapping, the others are decoded.
+    auto name = root.getObject().find("name")->second.getString();
+    EXPECT_GE(name.data(), bytes.data());
+    EXPECT_LT(name.data(), bytes.data() + bytes.size());
+    auto escaped = root.getObject().find("escaped")->second.getString();
+    EXPECT_EQ(escaped, "line\nbreak, and long enough");
+    EXPECT_TRUE(escaped.data() < bytes.data() || escaped.data() >= bytes.data() + bytes.size());
+  }
+
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << "";
+  EXPECT_THROW(parseFile(path), SyntaxError);
+  std::remove(path.c_str());
+
+  EXPECT_THROW(parseFile(path), std::system_error);
+  EXPECT_THROW(JSON::MappedDocument document(path), std::system_error);
+}
+
+TEST(CppJSONTests, TestLazyDocument)
+{
+  std::string input = R"({"skipped": {"deep": [[1, 2], {"x": "y"}], "bad": 1x}, "name": "a\tb",)"
+                      R"( "list": [10, -2.5, true, null, "s", [3]], "big": 18446744073709551615})";
+  JSON::LazyDocument document(input);
+  auto root = document.root();
+
+  EXPECT_TRUE(root.isObject());
+  EXPECT_EQ(root.size(), 4u);
+  EXPECT_EQ(root["name"].getString(), "a\tb");
+  {
+    // An escaped string is decoded once, later reads return the same one.
+    auto name = root["name"];
+    auto decoded = name.getString();
+    size_t before = allocationCount;
+    for (auto i = 0; i < 100; i++)
+      EXPECT_EQ(name.getString().data(), decoded.data());
+    EXPECT_EQ(allocationCount, before);
+  }
+  EXPECT_EQ(root["big"].getUint64(), 18446744073709551615ull);
+  EXPECT_TRUE(root.contains("list"));
+  EXPECT_FALSE(root.contains("missing"));
+
+  auto list = root["list"];
+  EXPECT_EQ(list.size(), 6u);
+  EXPECT_EQ(list[0].getInt64(), 10);
+  EXPECT_EQ(list[1].getNumber(), -2.5);
+  EXPECT_TRUE(list[2].getBool());
+  EXPECT_TRUE(list[3].isNull());
+  EXPECT_EQ(list[4].getString(), "s");
+  EXPECT_EQ(list[5][0].getInt64(), 3);
+  EXPECT_EQ(toString(list.toJSON()), toString(parse(R"([10, -2.5, true, null, "s", [3]])")));
+
+  // Strings without escapes are views into the input.
+  EXPECT_EQ(list[4].getString().data(), input.data() + input.find("\"s\"") + 1);
+
+  // The invalid number is only found when it is read.
+  EXPECT_EQ(root["skipped"]["deep"][1]["x"].getString(), "y");
+  EXPECT_THROW(root["skipped"]["bad"].getNumber(), SyntaxError);
+
+  EXPECT_THROW(root["missing"], std::out_of_range);
+  EXPECT_THROW(list[6], std::out_of_range);
+  EXPECT_THROW(list["key"], std::logic_error);
+  EXPECT_THROW(root["name"].getNumber(), std::logic_error);
+
+  // The structure is checked up front.
+  EXPECT_THROW(JSON::LazyDocument("[1, {2]}"), SyntaxError);
+  EXPECT_THROW(JSON::LazyDocument("[1, 2"), SyntaxError);
+  EXPECT_THROW(JSON::LazyDocument("[1] 2"), SyntaxError);
+  EXPECT_THROW(JSON::LazyDocument("\"open"), SyntaxError);
+  EXPECT_THROW(JSON::LazyDocument(""), SyntaxError);
+  EXPECT_THROW(JSON::LazyDocument("[1 2]").root().size(), SyntaxError);
+
+  // A value missing before a comma or a colon is a syntax error, not a number.
+  for (auto input : {R"({"a"::1})", R"({"a":,"b":1})", R"({"a":})"})
+  {
+    JSON::LazyDocument malformed(input);
+    EXPECT_THROW(malformed.root()["a"], SyntaxError) << input;
+    EXPECT_THROW(malformed.root().size(), SyntaxError) << input;
+  }
+  JSON::LazyDocument malformed("[,1]");
+  EXPECT_THROW(malformed.root()[0], SyntaxError);
+  EXPECT_THROW(malformed.root().size(), SyntaxError);
+}